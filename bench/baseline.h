@@ -0,0 +1,295 @@
+#ifndef BENCH_BASELINE_H
+#define BENCH_BASELINE_H
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "options.h"
+#include "report.h"
+#include "stats.h"
+
+// Saved results to check later runs against: the driver writes one with
+// --save-baseline and compares against one with --compare, flagging
+// configurations whose throughput dropped significantly. The file is
+// tab-separated text with one line per configuration, so it reviews and
+// diffs well under version control:
+//
+//     # sync benchmark baseline
+//     version     1
+//     cpu_model   Intel(R) Xeon(R) ...
+//     compiler    gcc 12.2.0
+//     timestamp   2026-01-01T00:00:00Z
+//     options     iterations=1000000 duration=0 cs=0 ...
+//     result      lock  mcs  counter  4  none  1.2e+07,1.19e+07,...
+//
+// A result line is kind, primitive, workload, threads, placement and the
+// throughput (operations/second) of every timed trial.
+// BASELINE_VERSION changes whenever the format or what a benchmark
+// measures does, and files of another version are refused rather than
+// compared.
+inline constexpr int BASELINE_VERSION = 1;
+
+// The options that change what a run measures, so baselines taken with
+// different ones can be told apart. Trials and output format are left out.
+inline std::string describe_options(const Options& options) {
+    std::ostringstream text;
+    text << "iterations=" << options.iterations << " duration=" << options.duration
+         << " cs=" << options.criticalSection << " outside=" << options.outsideWork << " think=" << options.think
+         << " workload=" << options.workload << " lines=" << options.lines
+         << " write-percent=" << options.writePercent << " size=" << options.workloadSize
+         << " locks=" << options.locks << " lock-padding=" << options.lockPadding
+         << " timeout=" << options.timeout << " placement=" << placement_name(options.placement);
+    return text.str();
+}
+
+struct BaselineEntry {
+    std::string kind;
+    std::string primitive;
+    std::string workload;
+    int threads = 0;
+    std::string placement;
+    std::vector<double> throughput; // per timed trial
+
+    static BaselineEntry of(const Result& r) {
+        return {r.kind, r.primitive, r.workload, r.threads, r.placement, r.trialThroughput};
+    }
+
+    bool matches(const Result& r) const {
+        return kind == r.kind && primitive == r.primitive && workload == r.workload && threads == r.threads &&
+               placement == r.placement;
+    }
+};
+
+struct Baseline {
+    HostInfo host;
+    std::string options;
+    std::vector<BaselineEntry> entries;
+
+    const BaselineEntry* find(const Result& r) const {
+        for (const BaselineEntry& e : entries) {
+            if (e.matches(r)) {
+                return &e;
+            }
+        }
+        return nullptr;
+    }
+
+    void save(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("cannot write baseline " + path);
+        }
+        out << "# sync benchmark baseline\n"
+            << "version\t" << BASELINE_VERSION << "\n"
+            << "cpu_model\t" << host.cpuModel << "\n"
+            << "compiler\t" << host.compiler << "\n"
+            << "timestamp\t" << host.timestamp << "\n"
+            << "options\t" << options << "\n";
+        out << std::setprecision(std::numeric_limits<double>::max_digits10);
+        for (const BaselineEntry& e : entries) {
+            out << "result\t" << e.kind << '\t' << e.primitive << '\t' << e.workload << '\t' << e.threads << '\t'
+                << e.placement << '\t';
+            for (size_t i = 0; i < e.throughput.size(); i++) {
+                out << (i ? "," : "") << e.throughput[i];
+            }
+            out << '\n';
+        }
+        if (!out) {
+            throw std::runtime_error("cannot write baseline " + path);
+        }
+    }
+
+    static Baseline load(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) {
+            throw std::runtime_error("cannot read baseline " + path);
+        }
+
+        Baseline baseline;
+        int version = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::vector<std::string> fields;
+            std::stringstream ss(line);
+            std::string field;
+            while (std::getline(ss, field, '\t')) {
+                fields.push_back(field);
+            }
+            const std::string value = fields.size() > 1 ? fields[1] : "";
+
+            if (fields[0] == "version") {
+                version = std::stoi(value);
+                if (version != BASELINE_VERSION) {
+                    throw std::runtime_error(path + " is a version " + value + " baseline; this driver reads version " +
+                                             std::to_string(BASELINE_VERSION));
+                }
+            } else if (fields[0] == "cpu_model") {
+                baseline.host.cpuModel = value;
+            } else if (fields[0] == "compiler") {
+                baseline.host.compiler = value;
+            } else if (fields[0] == "timestamp") {
+                baseline.host.timestamp = value;
+            } else if (fields[0] == "options") {
+                baseline.options = value;
+            } else if (fields[0] == "result" && fields.size() == 7) {
+                BaselineEntry e{fields[1], fields[2], fields[3], std::stoi(fields[4]), fields[5], {}};
+                for (const std::string& t : split_list(fields[6])) {
+                    e.throughput.push_back(std::stod(t));
+                }
+                baseline.entries.push_back(e);
+            } else {
+                throw std::runtime_error("malformed baseline line in " + path + ": " + line);
+            }
+        }
+        if (version == 0) {
+            throw std::runtime_error(path + " has no version line");
+        }
+        return baseline;
+    }
+};
+
+// Compares each result with its baseline configuration. A configuration
+// regressed when a one-sided Mann-Whitney test says its trials are slower
+// at significance alpha and the median dropped by more than tolerance
+// (a fraction); requiring both keeps tiny but consistent differences and
+// large but noisy ones from failing the gate. The interval is a 95%
+// bootstrap interval for the change of the median.
+class RegressionCheck {
+public:
+    enum class Verdict { Same, Slower, Faster, New, TooFewTrials };
+
+    struct Row {
+        Result result;
+        Verdict verdict = Verdict::New;
+        double baselineMedian = 0;
+        double currentMedian = 0;
+        double change = 0;
+        ChangeInterval interval;
+        double p = 1; // of the test in the direction of the change
+    };
+
+private:
+    const Baseline baseline;
+    const double alpha;
+    const double tolerance;
+    std::vector<Row> rows;
+
+    static const char* verdict_name(Verdict v) {
+        switch (v) {
+        case Verdict::Same: return "same";
+        case Verdict::Slower: return "SLOWER";
+        case Verdict::Faster: return "faster";
+        case Verdict::New: return "new";
+        case Verdict::TooFewTrials: return "too few trials";
+        }
+        return "?";
+    }
+
+    // The exact test cannot go below one ordering in C(n+m, n).
+    static double smallest_p(size_t n, size_t m) {
+        double orderings = 1;
+        for (size_t i = 1; i <= n; i++) {
+            orderings = orderings * (m + i) / i;
+        }
+        return 1 / orderings;
+    }
+
+public:
+    RegressionCheck(Baseline baseline, double alpha, double tolerance)
+        : baseline(std::move(baseline)), alpha(alpha), tolerance(tolerance) {}
+
+    const Baseline& reference() const { return baseline; }
+
+    const Row& add(const Result& r) {
+        Row row;
+        row.result = r;
+        const BaselineEntry* e = baseline.find(r);
+        if (e != nullptr && !e->throughput.empty() && !r.trialThroughput.empty()) {
+            const std::vector<double>& now = r.trialThroughput;
+            row.baselineMedian = median_of(e->throughput);
+            row.currentMedian = median_of(now);
+            row.change = row.baselineMedian > 0 ? row.currentMedian / row.baselineMedian - 1 : 0;
+            row.interval = bootstrap_median_change(now, e->throughput);
+
+            MannWhitney slower = mann_whitney_less(now, e->throughput);
+            MannWhitney faster = mann_whitney_less(e->throughput, now);
+            row.p = row.change < 0 ? slower.p : faster.p;
+            if (smallest_p(now.size(), e->throughput.size()) >= alpha) {
+                row.verdict = Verdict::TooFewTrials;
+            } else if (slower.p < alpha && row.change < -tolerance) {
+                row.verdict = Verdict::Slower;
+            } else if (faster.p < alpha && row.change > tolerance) {
+                row.verdict = Verdict::Faster;
+            } else {
+                row.verdict = Verdict::Same;
+            }
+        }
+        rows.push_back(row);
+        return rows.back();
+    }
+
+    int regressions() const {
+        int n = 0;
+        for (const Row& row : rows) {
+            n += row.verdict == Verdict::Slower;
+        }
+        return n;
+    }
+
+    void print(std::ostream& out, const std::string& currentOptions) const {
+        out << "\nRegression check against " << baseline.host.compiler << ", " << baseline.host.timestamp << " ("
+            << baseline.host.cpuModel << "); alpha " << alpha << ", tolerance " << 100 * tolerance << "%\n";
+        if (baseline.options != currentOptions) {
+            out << "warning: baseline options differ\n  baseline: " << baseline.options
+                << "\n  current:  " << currentOptions << "\n";
+        }
+        out << std::left << std::setw(10) << "Kind" << std::setw(26) << "Primitive" << std::setw(11) << "Workload"
+            << std::setw(9) << "Threads" << std::setw(16) << "Baseline ops/s" << std::setw(16) << "Current ops/s"
+            << std::setw(10) << "Change" << std::setw(20) << "95% interval" << std::setw(10) << "p"
+            << "Verdict\n"
+            << std::string(135, '-') << "\n";
+        for (const Row& row : rows) {
+            const Result& r = row.result;
+            out << std::left << std::setw(10) << r.kind << std::setw(26) << r.primitive << std::setw(11) << r.workload
+                << std::setw(9) << r.threads;
+            if (row.verdict == Verdict::New) {
+                out << std::setw(16) << "-" << std::setw(16) << std::fixed << std::setprecision(0)
+                    << median_of(r.trialThroughput) << std::defaultfloat << std::setw(40) << "" << "new\n";
+                continue;
+            }
+            std::ostringstream change, interval;
+            change << std::showpos << std::fixed << std::setprecision(1) << 100 * row.change << '%';
+            interval << std::showpos << std::fixed << std::setprecision(1) << '[' << 100 * row.interval.low << "%, "
+                     << 100 * row.interval.high << "%]";
+            out << std::fixed << std::setprecision(0) << std::setw(16) << row.baselineMedian << std::setw(16)
+                << row.currentMedian << std::defaultfloat << std::setw(10) << change.str() << std::setw(20)
+                << interval.str() << std::setw(10) << std::setprecision(3) << row.p << verdict_name(row.verdict)
+                << "\n";
+        }
+
+        int missing = 0;
+        for (const BaselineEntry& e : baseline.entries) {
+            bool seen = false;
+            for (const Row& row : rows) {
+                seen = seen || e.matches(row.result);
+            }
+            missing += !seen;
+        }
+        out << regressions() << " of " << rows.size() << " configurations slower";
+        if (missing > 0) {
+            out << "; " << missing << " baseline configurations not run";
+        }
+        out << "\n";
+    }
+};
+
+#endif
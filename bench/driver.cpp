@@ -0,0 +1,212 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include "../sync/sync.h"
+#include "options.h"
+#include "report.h"
+#include "runners.h"
+#include "baseline.h"
+
+// Benchmark driver: one binary for every lock, barrier and counter in the
+// sync library, configured from the command line instead of by editing
+// #defines and rebuilding.
+
+struct Primitive {
+    std::string name;
+    std::string kind;
+    std::function<Result(const Options&, int)> run;
+    int minThreads = 1;         // smaller --threads counts are skipped
+};
+
+template <typename LockType>
+Primitive lock_primitive(const std::string& name) {
+    return {name, "lock", run_lock<LockType>};
+}
+
+template <typename BarrierType>
+Primitive barrier_primitive(const std::string& name) {
+    return {name, "barrier", run_barrier<BarrierType>};
+}
+
+template <typename CounterType>
+Primitive counter_primitive(const std::string& name) {
+    return {name, "counter", run_counter<CounterType>};
+}
+
+template <typename QueueType>
+Primitive queue_primitive(const std::string& name) {
+    return {name, "queue", run_queue<QueueType>, 2};
+}
+
+template <typename DequeType>
+Primitive deque_primitive(const std::string& name) {
+    return {name, "deque", run_deque<DequeType>};
+}
+
+const std::vector<Primitive>& registry() {
+    static const std::vector<Primitive> primitives = {
+        lock_primitive<TASLock>("tas"),
+        lock_primitive<TASLockWithBackoff>("tas-backoff"),
+        lock_primitive<TTASLock>("ttas"),
+        lock_primitive<TTASLockWithBackoff>("ttas-backoff"),
+        lock_primitive<TicketLock>("ticket"),
+        lock_primitive<MCSLock>("mcs"),
+        lock_primitive<ParkingMCSLock>("mcs-park"),
+        lock_primitive<CLHLock>("clh"),
+        lock_primitive<AbortableCLHLock>("clh-abortable"),
+        lock_primitive<CohortLock<>>("cohort"),
+        lock_primitive<AdaptiveLock>("adaptive"),
+        lock_primitive<ElidedLock<TTASLock>>("ttas-elided"),
+        lock_primitive<PhaseFairRWLock>("phase-fair-rw"),
+        lock_primitive<BigReaderLock<>>("big-reader-rw"),
+        lock_primitive<std::mutex>("std-mutex"),
+
+        barrier_primitive<SenseReversingBarrier>("sense-reversing"),
+        barrier_primitive<ParkingSenseReversingBarrier>("sense-reversing-park"),
+        barrier_primitive<RelaxedSenseReversingBarrier>("sense-reversing-relaxed"),
+        barrier_primitive<TournamentBarrier>("tournament"),
+        barrier_primitive<DisseminationBarrier>("dissemination"),
+        barrier_primitive<StdBarrier>("std-barrier"),
+
+        counter_primitive<MutexCounter>("mutex-counter"),
+        counter_primitive<CompareSwapCounter>("cas-counter"),
+        counter_primitive<RelaxedCompareSwapCounter>("cas-counter-relaxed"),
+        counter_primitive<FetchAddCounter>("fetch-add-counter"),
+        counter_primitive<RelaxedFetchAddCounter>("fetch-add-counter-relaxed"),
+        counter_primitive<ShardedCounter>("sharded-counter"),
+        counter_primitive<FlatCombiningCounter>("flat-combining-counter"),
+        counter_primitive<DelegationCounter>("delegation-counter"),
+
+        queue_primitive<BoundedMPMCQueue<uint64_t>>("mpmc-ring"),
+        queue_primitive<BoundedMPMCQueue<uint64_t, CacheLinePadding>>("mpmc-ring-padded"),
+        queue_primitive<LockedQueue<uint64_t, TASLock>>("tas-queue"),
+        queue_primitive<LockedQueue<uint64_t, TASLockWithBackoff>>("tas-backoff-queue"),
+        queue_primitive<LockedQueue<uint64_t, TTASLock>>("ttas-queue"),
+        queue_primitive<LockedQueue<uint64_t, TTASLockWithBackoff>>("ttas-backoff-queue"),
+        queue_primitive<LockedQueue<uint64_t, TicketLock>>("ticket-queue"),
+        queue_primitive<LockedQueue<uint64_t, MCSLock>>("mcs-queue"),
+        queue_primitive<LockedQueue<uint64_t, ParkingMCSLock>>("mcs-park-queue"),
+        queue_primitive<LockedQueue<uint64_t, CLHLock>>("clh-queue"),
+        queue_primitive<LockedQueue<uint64_t, CohortLock<>>>("cohort-queue"),
+        queue_primitive<LockedQueue<uint64_t, AdaptiveLock>>("adaptive-queue"),
+        queue_primitive<LockedQueue<uint64_t, std::mutex>>("std-mutex-queue"),
+
+        deque_primitive<WorkStealingDeque<uint64_t>>("chase-lev-deque"),
+        deque_primitive<LockedDeque<uint64_t, TASLock>>("tas-deque"),
+        deque_primitive<LockedDeque<uint64_t, TASLockWithBackoff>>("tas-backoff-deque"),
+        deque_primitive<LockedDeque<uint64_t, TTASLock>>("ttas-deque"),
+        deque_primitive<LockedDeque<uint64_t, TTASLockWithBackoff>>("ttas-backoff-deque"),
+        deque_primitive<LockedDeque<uint64_t, TicketLock>>("ticket-deque"),
+        deque_primitive<LockedDeque<uint64_t, MCSLock>>("mcs-deque"),
+        deque_primitive<LockedDeque<uint64_t, ParkingMCSLock>>("mcs-park-deque"),
+        deque_primitive<LockedDeque<uint64_t, CLHLock>>("clh-deque"),
+        deque_primitive<LockedDeque<uint64_t, CohortLock<>>>("cohort-deque"),
+        deque_primitive<LockedDeque<uint64_t, AdaptiveLock>>("adaptive-deque"),
+        deque_primitive<LockedDeque<uint64_t, std::mutex>>("std-mutex-deque"),
+    };
+    return primitives;
+}
+
+// Expands names and kinds ("lock", "barrier", "counter", "queue", "deque", "all") into the
+// primitives to run, in registry order for kinds.
+std::vector<const Primitive*> select(const std::vector<std::string>& names) {
+    std::vector<const Primitive*> selected;
+    std::vector<std::string> wanted = names.empty() ? std::vector<std::string>{"all"} : names;
+
+    for (const std::string& name : wanted) {
+        bool found = false;
+        for (const Primitive& p : registry()) {
+            if (name == "all" || name == p.kind || name == p.name) {
+                selected.push_back(&p);
+                found = true;
+            }
+        }
+        if (!found) {
+            throw std::invalid_argument("unknown primitive " + name + " (see --list)");
+        }
+    }
+    return selected;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<const Primitive*> selected;
+    try {
+        options = parse_options(argc, argv);
+        if (options.help) {
+            print_usage(std::cout, argv[0]);
+            return 0;
+        }
+        if (options.list) {
+            for (const Primitive& p : registry()) {
+                std::cout << p.kind << "\t" << p.name << "\n";
+            }
+            return 0;
+        }
+        selected = select(options.primitives);
+    } catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << "\n";
+        print_usage(std::cerr, argv[0]);
+        return 2;
+    }
+
+    // Read before running anything, so a bad file fails fast.
+    std::optional<RegressionCheck> check;
+    try {
+        if (!options.compareBaseline.empty()) {
+            check.emplace(Baseline::load(options.compareBaseline), options.alpha, options.tolerance);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 2;
+    }
+
+    const HostInfo host = HostInfo::detect();
+    Reporter reporter(std::cout, options.format, host, options.latency, options.timeout > 0, options.perf,
+                      options.perfEvent);
+    reporter.begin();
+
+    Baseline saved{host, describe_options(options), {}};
+    bool allCorrect = true;
+    for (const Primitive* p : selected) {
+        for (int threads : options.threads) {
+            if (threads < p->minThreads) {
+                std::cerr << "note: skipping " << p->name << " at " << threads << " thread"
+                          << (threads == 1 ? "" : "s") << ": " << p->kind << " benchmarks need at least "
+                          << p->minThreads << "\n";
+                continue;
+            }
+            Result r = p->run(options, threads);
+            r.primitive = p->name;
+            reporter.add(r);
+            allCorrect = allCorrect && r.correct;
+            saved.entries.push_back(BaselineEntry::of(r));
+            if (check) {
+                check->add(r);
+            }
+        }
+    }
+
+    reporter.end();
+
+    if (!options.saveBaseline.empty()) {
+        try {
+            saved.save(options.saveBaseline);
+        } catch (const std::exception& e) {
+            std::cerr << "error: " << e.what() << "\n";
+            return 2;
+        }
+    }
+    if (check) {
+        // keeps csv and json output parseable
+        check->print(options.format == "table" ? std::cout : std::cerr, describe_options(options));
+    }
+
+    if (!allCorrect) {
+        return 1;
+    }
+    return check && check->regressions() > 0 ? 3 : 0;
+}
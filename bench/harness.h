@@ -0,0 +1,376 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "latency.h"
+#include "perf_counters.h"
+#include "../sync/lock.h"
+#include "../sync/pool.h"
+
+// The measurement loop behind every benchmark: the exercise harnesses and
+// the driver's runners all go through run_trials(), so warmup, repeated
+// trials, outlier rejection, pinning, latency and hardware counters are
+// implemented once. Trials run on a persistent pool of pinned threads
+// (sync/pool.h), so only the steady-state region is timed.
+//
+//     ThreadPlan plan{threads, placement_cpus(placement, threads), iterations};
+//     RunResult r = run_lock_trials(lock, plan, TrialOptions{});
+//     r.ops_per_second();   // of the median trial
+//     r.relative_stddev();  // spread over the trials that were kept
+
+// Locks the harnesses can drive. Node-based locks (MCS) are given a queue
+// node from the waiter's QueueNodeArena; the exercise locks use acquire()/release();
+// anything else, std::mutex included, lock()/unlock().
+template <typename L>
+concept NodeLockable = requires(L& l, typename L::Node& node) {
+    l.lock(node);
+    l.unlock(node);
+};
+
+template <typename L>
+concept AcquireReleaseLockable = requires(L& l) {
+    l.acquire();
+    l.release();
+};
+
+template <typename L>
+concept BenchmarkLockable = NodeLockable<L> || AcquireReleaseLockable<L> || BasicLockable<L>;
+
+template <typename C>
+concept BenchmarkCounter = requires(C& c) {
+    c.increment();
+    { c.get() } -> std::convertible_to<int64_t>;
+};
+
+// Runs section() between acquire() and release(). With stats, also records
+// how long acquire took (wait) and how long the lock was held (hold).
+template <typename Acquire, typename Section, typename Release>
+inline void timed_section(ThreadLatency* stats, Acquire acquire, Section& section, Release release) {
+    if (stats == nullptr) {
+        acquire();
+        section();
+        release();
+        return;
+    }
+
+    uint64_t requested = read_ticks();
+    acquire();
+    uint64_t acquired = read_ticks();
+    section();
+    uint64_t released = read_ticks();
+    release();
+
+    stats->wait.record(acquired - requested);
+    stats->hold.record(released - acquired);
+}
+
+// Runs section() with lock held, through the lock's own interface.
+template <BenchmarkLockable L, typename Section>
+inline void run_locked(L& lock, ThreadLatency* stats, Section& section) {
+    if constexpr (NodeLockable<L>) {
+        auto& arena = QueueNodeArena<typename L::Node>::mine();
+        typename L::Node& node = arena.take(&lock);
+        timed_section(stats, [&]() { lock.lock(node); }, section, [&]() { lock.unlock(node); });
+        arena.give_back(node);
+    } else if constexpr (AcquireReleaseLockable<L>) {
+        timed_section(stats, [&]() { lock.acquire(); }, section, [&]() { lock.release(); });
+    } else {
+        timed_section(stats, [&]() { lock.lock(); }, section, [&]() { lock.unlock(); });
+    }
+}
+
+// run_locked() with a deadline: gives up, without running section(), if
+// the lock is not acquired within timeout, and returns false. With stats,
+// only acquisitions that succeeded are recorded.
+template <TimedLockable L, typename Section>
+inline bool run_locked_for(L& lock, std::chrono::nanoseconds timeout, ThreadLatency* stats, Section& section) {
+    if (stats == nullptr) {
+        if (!lock.try_lock_for(timeout)) {
+            return false;
+        }
+        section();
+        lock.unlock();
+        return true;
+    }
+
+    uint64_t requested = read_ticks();
+    if (!lock.try_lock_for(timeout)) {
+        return false;
+    }
+    uint64_t acquired = read_ticks();
+    section();
+    uint64_t released = read_ticks();
+    lock.unlock();
+
+    stats->wait.record(acquired - requested);
+    stats->hold.record(released - acquired);
+    return true;
+}
+
+// Who runs, where, and for how long.
+struct ThreadPlan {
+    int threads = 1;
+    std::vector<int> cpus;      // thread i runs on cpus[i % cpus.size()]; empty: unpinned
+    long operations = 0;        // per thread, when duration is 0
+    double duration = 0;        // seconds; > 0 runs until it elapses instead
+};
+
+// How often to measure and what to record while doing it.
+struct TrialOptions {
+    int warmup = 1;             // trials run first and thrown away
+    int trials = 5;             // timed trials
+    double outlierMads = 3.0;   // drop trials further than this from the median, in MADs
+    bool latency = false;       // per-operation wait/hold histograms
+    bool perf = false;          // hardware counters on every thread
+    uint64_t perfRawEvent = 0;  // and this raw PMU event (perf_counters.h), 0: none
+};
+
+struct Measurement {
+    long operations = 0;
+    double seconds = 0;
+    std::vector<int> cpus;
+
+    double throughput() const { return seconds > 0 ? operations / seconds : 0; }
+};
+
+// Everything the timed trials measured.
+struct RunResult {
+    int threads = 0;
+    std::vector<int> cpus;
+    std::vector<Measurement> trials;    // every timed trial, in run order
+    int rejected = 0;                   // trials dropped as outliers
+
+    // The kept trial with the median throughput, and the spread of
+    // throughput over the kept trials.
+    long operations = 0;
+    double seconds = 0;
+    double meanThroughput = 0;
+    double stddevThroughput = 0;
+
+    bool correct = true;                // every trial, warmups included
+
+    // Summed over the timed trials, so per-operation figures use
+    // measuredOperations rather than operations.
+    long measuredOperations = 0;
+    bool hasLatency = false;
+    std::vector<ThreadLatency> latency; // per thread
+    bool hasPerf = false;
+    PerfSample perf;
+
+    double ops_per_second() const { return seconds > 0 ? operations / seconds : 0; }
+    double relative_stddev() const { return meanThroughput > 0 ? stddevThroughput / meanThroughput : 0; }
+};
+
+// Records a thread's own operation count and running time, for fairness.
+inline void finish_thread(ThreadLatency* stats, long operations, std::chrono::steady_clock::time_point began) {
+    if (stats != nullptr) {
+        stats->operations = operations;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+    }
+}
+
+// The worker pool every benchmark runs on. It is kept while consecutive
+// runs ask for the same threads on the same CPUs, so warmups, trials and
+// repeated configurations reuse pinned threads, and rebuilt when they do
+// not.
+inline WorkerPool& benchmark_pool(int numThreads, const std::vector<int>& cpus) {
+    static std::unique_ptr<WorkerPool> pool;
+    if (!pool || pool->size() != numThreads || pool->cpus() != cpus) {
+        pool.reset();
+        pool = std::make_unique<WorkerPool>(numThreads, cpus);
+    }
+    return *pool;
+}
+
+// Runs body(threadIndex, keepGoing) on numThreads pooled threads released
+// together and times the steady-state region: from their release until the
+// last one finishes, without thread creation, wake-up or join. Thread i is
+// pinned to cpus[i % cpus.size()] unless cpus is empty. body returns the
+// number of operations it did; keepGoing() is true until the duration
+// elapses (or, in fixed-count runs, always true and body stops on its own).
+template <typename Body>
+Measurement run_threads(int numThreads, double duration, const std::vector<int>& cpus, Body body) {
+    std::atomic<bool> stop{false};
+    std::atomic<long> operations{0};
+
+    auto keepGoing = [&stop]() { return !stop.load(std::memory_order_relaxed); };
+
+    Measurement m;
+    m.cpus = cpus;
+    m.seconds = benchmark_pool(numThreads, cpus).run_timed(
+        [&](int i) { operations.fetch_add(body(i, keepGoing), std::memory_order_relaxed); },
+        [&]() {
+            if (duration > 0) {
+                std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+                stop.store(true, std::memory_order_relaxed);
+            }
+        });
+    m.operations = operations.load();
+    return m;
+}
+
+// Drops trials whose throughput is more than outlierMads median absolute
+// deviations from the median (with at least three trials and a non-zero
+// MAD), then fills in the median trial and the spread of the rest.
+inline void summarize_trials(RunResult& r, double outlierMads) {
+    auto median_of = [](std::vector<double> values) {
+        std::sort(values.begin(), values.end());
+        size_t n = values.size();
+        return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+    };
+
+    std::vector<double> throughput;
+    for (const Measurement& m : r.trials) {
+        throughput.push_back(m.throughput());
+    }
+    if (throughput.empty()) {
+        return;
+    }
+
+    std::vector<const Measurement*> kept;
+    double median = median_of(throughput);
+    std::vector<double> deviations;
+    for (double t : throughput) {
+        deviations.push_back(std::fabs(t - median));
+    }
+    // 1.4826 * MAD estimates the standard deviation of normal data
+    double mad = 1.4826 * median_of(deviations);
+    for (const Measurement& m : r.trials) {
+        if (r.trials.size() < 3 || mad == 0 || std::fabs(m.throughput() - median) <= outlierMads * mad) {
+            kept.push_back(&m);
+        }
+    }
+    r.rejected = static_cast<int>(r.trials.size() - kept.size());
+
+    std::sort(kept.begin(), kept.end(),
+              [](const Measurement* a, const Measurement* b) { return a->throughput() < b->throughput(); });
+    const Measurement& middle = *kept[(kept.size() - 1) / 2];
+    r.operations = middle.operations;
+    r.seconds = middle.seconds;
+
+    double sum = 0;
+    for (const Measurement* m : kept) {
+        sum += m->throughput();
+    }
+    r.meanThroughput = sum / kept.size();
+    double squares = 0;
+    for (const Measurement* m : kept) {
+        squares += (m->throughput() - r.meanThroughput) * (m->throughput() - r.meanThroughput);
+    }
+    r.stddevThroughput = kept.size() > 1 ? std::sqrt(squares / (kept.size() - 1)) : 0;
+}
+
+// Runs options.warmup untimed and then options.trials timed trials of the
+// plan. Before each trial prepare() resets whatever body works on; then
+// body(thread, more, stats) runs on every thread and returns how many
+// operations it did, where more(done) says whether to start another one
+// and stats is where to record latency (null when not recording). After
+// each trial verify(operations) checks the result.
+template <typename Prepare, typename Body, typename Verify>
+RunResult run_trials(const ThreadPlan& plan, const TrialOptions& options, Prepare prepare, Body body,
+                     Verify verify) {
+    RunResult r;
+    r.threads = plan.threads;
+    r.cpus = plan.cpus;
+    r.hasLatency = options.latency;
+    r.hasPerf = options.perf;
+    r.latency.resize(options.latency ? plan.threads : 0);
+
+    for (int trial = 0; trial < options.warmup + options.trials; trial++) {
+        bool timed = trial >= options.warmup;
+        std::vector<ThreadLatency> latency(timed && options.latency ? plan.threads : 0);
+        std::vector<PerfSample> perf(plan.threads);
+
+        prepare();
+        Measurement m = run_threads(plan.threads, plan.duration, plan.cpus, [&](int id, auto keepGoing) {
+            PerfScope counters(timed && options.perf ? &perf[id] : nullptr, options.perfRawEvent);
+            ThreadLatency* stats = latency.empty() ? nullptr : &latency[id];
+            auto more = [&](long done) { return plan.duration > 0 ? keepGoing() : done < plan.operations; };
+            auto began = std::chrono::steady_clock::now();
+            long done = body(id, more, stats);
+            finish_thread(stats, done, began);
+            return done;
+        });
+        r.correct = verify(m.operations) && r.correct;
+
+        if (!timed) {
+            continue;
+        }
+        r.trials.push_back(m);
+        r.measuredOperations += m.operations;
+        for (size_t i = 0; i < latency.size(); i++) {
+            r.latency[i].wait.merge(latency[i].wait);
+            r.latency[i].hold.merge(latency[i].hold);
+            r.latency[i].operations += latency[i].operations;
+            r.latency[i].seconds += latency[i].seconds;
+        }
+        if (options.perf) {
+            r.perf.merge(merge_perf(perf));
+        }
+    }
+
+    summarize_trials(r, options.outlierMads);
+    return r;
+}
+
+// Lock benchmark: every operation takes the lock, increments a shared
+// count, runs section() and releases the lock. Correct if no increment was
+// lost.
+template <BenchmarkLockable L, typename Section>
+RunResult run_lock_trials(L& lock, const ThreadPlan& plan, const TrialOptions& options, Section section) {
+    long shared = 0;
+    auto critical = [&]() {
+        shared++;
+        section();
+    };
+    return run_trials(
+        plan, options, [&]() { shared = 0; },
+        [&](int, auto more, ThreadLatency* stats) {
+            long done = 0;
+            for (; more(done); done++) {
+                run_locked(lock, stats, critical);
+            }
+            return done;
+        },
+        [&](long operations) { return shared == operations; });
+}
+
+template <BenchmarkLockable L>
+RunResult run_lock_trials(L& lock, const ThreadPlan& plan, const TrialOptions& options) {
+    return run_lock_trials(lock, plan, options, []() {});
+}
+
+// Counter benchmark: every operation is one increment, timed as wait when
+// recording latency. Each trial gets a fresh counter; correct if get()
+// matches the number of increments.
+template <BenchmarkCounter C>
+RunResult run_counter_trials(const ThreadPlan& plan, const TrialOptions& options) {
+    std::optional<C> counter;
+    return run_trials(
+        plan, options, [&]() { counter.emplace(); },
+        [&](int, auto more, ThreadLatency* stats) {
+            long done = 0;
+            for (; more(done); done++) {
+                if (stats != nullptr) {
+                    uint64_t before = read_ticks();
+                    counter->increment();
+                    stats->wait.record(read_ticks() - before);
+                } else {
+                    counter->increment();
+                }
+            }
+            return done;
+        },
+        [&](long operations) { return counter->get() == operations; });
+}
+
+#endif
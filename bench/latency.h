@@ -0,0 +1,139 @@
+#ifndef BENCH_LATENCY_H
+#define BENCH_LATENCY_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "../sync/config.h"
+#include "../sync/clock.h"
+
+// Low-overhead latency capture for the benchmarks: log-bucketed
+// histograms of read_ticks() deltas that each thread fills privately, and
+// summaries computed after the threads are joined.
+
+// HDR-style histogram: values below 2^SUB_BITS get a bucket each; above
+// that every power of two is split into 2^(SUB_BITS-1) buckets, so any
+// value is recorded within about 3% and the whole 64-bit range fits in
+// under a thousand counters.
+class LatencyHistogram {
+private:
+    static constexpr int SUB_BITS = 5;
+    static constexpr int SUB_COUNT = 1 << SUB_BITS;
+    static constexpr int HALF_COUNT = SUB_COUNT / 2;
+    static constexpr int BUCKETS = SUB_COUNT + (64 - SUB_BITS) * HALF_COUNT;
+
+    std::array<uint64_t, BUCKETS> counts{};
+    uint64_t total = 0;
+    uint64_t maxValue = 0;
+
+    static int bucket_of(uint64_t value) {
+        if (value < SUB_COUNT) {
+            return static_cast<int>(value);
+        }
+        int msb = 63 - __builtin_clzll(value);
+        int shift = msb - (SUB_BITS - 1);
+        int top = static_cast<int>(value >> shift);
+        return SUB_COUNT + (shift - 1) * HALF_COUNT + (top - HALF_COUNT);
+    }
+
+    // Midpoint of the values that land in bucket.
+    static uint64_t value_of(int bucket) {
+        if (bucket < SUB_COUNT) {
+            return bucket;
+        }
+        int shift = (bucket - SUB_COUNT) / HALF_COUNT + 1;
+        uint64_t top = (bucket - SUB_COUNT) % HALF_COUNT + HALF_COUNT;
+        uint64_t low = top << shift;
+        return low + ((uint64_t(1) << shift) >> 1);
+    }
+
+public:
+    void record(uint64_t value) {
+        counts[bucket_of(value)]++;
+        total++;
+        maxValue = std::max(maxValue, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (int i = 0; i < BUCKETS; i++) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maxValue; }
+
+    // Value at quantile q in [0, 1]; 0 if nothing was recorded.
+    uint64_t percentile(double q) const {
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(q * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(value_of(i), maxValue);
+            }
+        }
+        return maxValue;
+    }
+};
+
+// Percentiles of a histogram of ticks, in nanoseconds.
+struct LatencySummary {
+    double p50 = 0;
+    double p99 = 0;
+    double p999 = 0;
+    double max = 0;
+
+    static LatencySummary of(const LatencyHistogram& h) {
+        double scale = ns_per_tick();
+        LatencySummary s;
+        s.p50 = h.percentile(0.50) * scale;
+        s.p99 = h.percentile(0.99) * scale;
+        s.p999 = h.percentile(0.999) * scale;
+        s.max = h.max() * scale;
+        return s;
+    }
+};
+
+// What one thread records. Padded so threads never share a line while
+// recording.
+struct alignas(CACHE_LINE_SIZE) ThreadLatency {
+    LatencyHistogram wait;  // acquire wait, or barrier episode
+    LatencyHistogram hold;  // time inside the critical section
+    long operations = 0;
+    double seconds = 0;     // this thread's own running time
+
+    double throughput() const { return seconds > 0 ? operations / seconds : 0; }
+};
+
+// Jain's fairness index over per-thread throughput: 1 when every thread
+// progressed at the same rate, 1/n when one thread did all the work.
+inline double jain_fairness(const std::vector<ThreadLatency>& threads) {
+    double sum = 0;
+    double sumSquares = 0;
+    for (const ThreadLatency& t : threads) {
+        sum += t.throughput();
+        sumSquares += t.throughput() * t.throughput();
+    }
+    return sumSquares > 0 ? sum * sum / (threads.size() * sumSquares) : 1.0;
+}
+
+// All threads' histograms merged into one pair.
+inline ThreadLatency merge_latency(const std::vector<ThreadLatency>& threads) {
+    ThreadLatency merged;
+    for (const ThreadLatency& t : threads) {
+        merged.wait.merge(t.wait);
+        merged.hold.merge(t.hold);
+        merged.operations += t.operations;
+    }
+    return merged;
+}
+
+#endif
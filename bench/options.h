@@ -0,0 +1,276 @@
+#ifndef BENCH_OPTIONS_H
+#define BENCH_OPTIONS_H
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <algorithm>
+#include "../sync/topology.h"
+#include "perf_counters.h"
+
+// Command-line configuration of a driver run. Every knob that used to be a
+// #define or a hard-coded local in the exercise harnesses lives here.
+// Critical-section workloads, see workload.h.
+inline const std::vector<std::string> WORKLOAD_NAMES = {"counter", "footprint", "hashmap", "queue"};
+
+struct Options {
+    std::vector<std::string> primitives;
+    std::vector<int> threads;
+    long iterations = 1000000;      // per thread; ignored when duration > 0
+    double duration = 0;            // seconds; > 0 switches to timed runs
+    int warmup = 0;                 // untimed trials before the timed ones
+    int trials = 1;                 // timed trials; the median is reported
+    int criticalSection = 0;        // busy-work units inside the lock
+    int outsideWork = 0;            // busy-work units between operations
+    double think = 0;               // mean of extra exponential think time, in units
+    std::string workload = "counter";
+    int lines = 1;                  // footprint: cache lines per critical section
+    int writePercent = 100;         // footprint: share of those touches that write
+    long workloadSize = 4096;       // hashmap: key range; queue: length
+    int locks = 1;                  // > 1: false-sharing mode, an array of locks
+    std::string lockPadding = "none"; // array layout: none, line or pair
+    double timeout = 0;             // microseconds; > 0: locks are tried with try_lock_for
+    std::string format = "table";   // table, csv or json
+    std::string saveBaseline;       // write the results here as a baseline
+    std::string compareBaseline;    // check the results against this baseline
+    double alpha = 0.01;            // significance level of that check
+    double tolerance = 0.05;        // slowdown of the median that counts as a regression
+    bool latency = false;           // record per-operation latency histograms
+    bool perf = false;              // count hardware events on every thread
+    std::string perfEvent;          // plus this raw event, as given (rNNNN); empty: none
+    uint64_t perfRawEvent = 0;      // its PERF_TYPE_RAW config
+    Placement placement = Placement::None;
+    bool list = false;
+    bool help = false;
+};
+
+inline std::vector<std::string> split_list(const std::string& value) {
+    std::vector<std::string> items;
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// Thread counts: "1,2,4", a doubling range "1-16" that also ends on its
+// upper bound when doubling steps over it ("1-12" is 1,2,4,8,12), or "max"
+// for hardware_concurrency().
+inline std::vector<int> parse_threads(const std::string& value) {
+    const int max = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> threads;
+    for (const std::string& item : split_list(value)) {
+        size_t dash = item.find('-');
+        if (item == "max") {
+            threads.push_back(max);
+        } else if (dash != std::string::npos) {
+            std::string last = item.substr(dash + 1);
+            int from = std::stoi(item.substr(0, dash));
+            int to = last == "max" ? max : std::stoi(last);
+            // checked before doubling: a range from 0 would never end
+            if (from <= 0 || from > to) {
+                throw std::invalid_argument("bad --threads range " + item);
+            }
+            for (int n = from;; n = std::min(n * 2, to)) {
+                threads.push_back(n);
+                if (n == to) {
+                    break;
+                }
+            }
+        } else {
+            threads.push_back(std::stoi(item));
+        }
+    }
+    for (int n : threads) {
+        if (n <= 0) {
+            throw std::invalid_argument("thread counts must be positive");
+        }
+    }
+    return threads;
+}
+
+// Accepts both --key=value and --key value. Throws std::invalid_argument on
+// anything it does not understand.
+inline Options parse_options(int argc, char** argv) {
+    Options options;
+    options.threads = parse_threads("1-max");
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string key = arg;
+        std::string value;
+        bool hasValue = false;
+
+        size_t eq = arg.find('=');
+        if (eq != std::string::npos) {
+            key = arg.substr(0, eq);
+            value = arg.substr(eq + 1);
+            hasValue = true;
+        }
+
+        auto need_value = [&]() -> const std::string& {
+            if (!hasValue) {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument(key + " needs a value");
+                }
+                value = argv[++i];
+                hasValue = true;
+            }
+            return value;
+        };
+
+        if (key == "--help" || key == "-h") {
+            options.help = true;
+        } else if (key == "--list") {
+            options.list = true;
+        } else if (key == "--latency") {
+            options.latency = true;
+        } else if (key == "--perf") {
+            options.perf = true;
+        } else if (key == "--perf-event") {
+            options.perfEvent = need_value();
+            options.perfRawEvent = parse_perf_raw_event(options.perfEvent);
+            options.perf = true;
+        } else if (key == "--primitive" || key == "-p") {
+            for (const std::string& name : split_list(need_value())) {
+                options.primitives.push_back(name);
+            }
+        } else if (key == "--threads" || key == "-t") {
+            options.threads = parse_threads(need_value());
+        } else if (key == "--iterations" || key == "-n") {
+            options.iterations = std::stol(need_value());
+        } else if (key == "--duration" || key == "-d") {
+            options.duration = std::stod(need_value());
+        } else if (key == "--warmup") {
+            options.warmup = std::stoi(need_value());
+        } else if (key == "--trials") {
+            options.trials = std::stoi(need_value());
+            if (options.trials <= 0) {
+                throw std::invalid_argument("--trials must be positive");
+            }
+        } else if (key == "--cs") {
+            options.criticalSection = std::stoi(need_value());
+        } else if (key == "--outside") {
+            options.outsideWork = std::stoi(need_value());
+        } else if (key == "--think") {
+            options.think = std::stod(need_value());
+        } else if (key == "--workload" || key == "-w") {
+            options.workload = need_value();
+            if (std::find(WORKLOAD_NAMES.begin(), WORKLOAD_NAMES.end(), value) == WORKLOAD_NAMES.end()) {
+                throw std::invalid_argument("unknown workload " + value);
+            }
+        } else if (key == "--lines") {
+            options.lines = std::stoi(need_value());
+        } else if (key == "--write-percent") {
+            options.writePercent = std::stoi(need_value());
+        } else if (key == "--size") {
+            options.workloadSize = std::stol(need_value());
+        } else if (key == "--locks") {
+            options.locks = std::stoi(need_value());
+            if (options.locks <= 0) {
+                throw std::invalid_argument("--locks must be positive");
+            }
+        } else if (key == "--lock-padding") {
+            options.lockPadding = need_value();
+            if (value != "none" && value != "line" && value != "pair") {
+                throw std::invalid_argument("unknown lock padding " + value);
+            }
+        } else if (key == "--timeout") {
+            options.timeout = std::stod(need_value());
+            if (options.timeout <= 0) {
+                throw std::invalid_argument("--timeout must be positive");
+            }
+        } else if (key == "--placement") {
+            if (!parse_placement(need_value(), options.placement)) {
+                throw std::invalid_argument("unknown placement " + value);
+            }
+        } else if (key == "--format" || key == "-f") {
+            options.format = need_value();
+            if (options.format != "table" && options.format != "csv" && options.format != "json") {
+                throw std::invalid_argument("unknown format " + options.format);
+            }
+        } else if (key == "--save-baseline") {
+            options.saveBaseline = need_value();
+        } else if (key == "--compare") {
+            options.compareBaseline = need_value();
+        } else if (key == "--alpha") {
+            options.alpha = std::stod(need_value());
+            if (options.alpha <= 0 || options.alpha >= 1) {
+                throw std::invalid_argument("--alpha must be between 0 and 1");
+            }
+        } else if (key == "--tolerance") {
+            options.tolerance = std::stod(need_value()) / 100;
+            if (options.tolerance < 0) {
+                throw std::invalid_argument("--tolerance must not be negative");
+            }
+        } else {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+
+    if (options.threads.empty()) {
+        throw std::invalid_argument("no thread counts given");
+    }
+    return options;
+}
+
+inline void print_usage(std::ostream& out, const char* program) {
+    out << "Usage: " << program << " [options]\n"
+        << "  -p, --primitive NAMES   comma-separated primitives, or a kind (lock, barrier,\n"
+        << "                          counter, queue, deque); default: all. See --list.\n"
+        << "  -t, --threads LIST      thread counts: 1,2,4 or a doubling range 1-16; 'max'\n"
+        << "                          is hardware_concurrency() (default 1-max). Queue\n"
+        << "                          primitives split them into producers (half,\n"
+        << "                          rounded down) and consumers, and skip counts below 2\n"
+        << "  -n, --iterations N      operations per thread (default 1000000)\n"
+        << "  -d, --duration SECONDS  run for a fixed time instead of a fixed count\n"
+        << "      --warmup N          untimed trials before measuring (default 0)\n"
+        << "      --trials N          timed trials; reports the median after dropping\n"
+        << "                          outliers (default 1)\n"
+        << "      --cs N              busy-work units inside each critical section\n"
+        << "      --outside N         busy-work units between operations\n"
+        << "      --think MEAN        plus exponentially distributed think time with this\n"
+        << "                          mean (units), so lock requests arrive as a Poisson process\n"
+        << "  -w, --workload NAME     lock critical section: counter (default), footprint,\n"
+        << "                          hashmap or queue\n"
+        << "      --lines N           footprint: cache lines touched per critical section\n"
+        << "      --write-percent P   footprint: percentage of touches that write (default 100)\n"
+        << "      --size N            hashmap: key range; queue workload: steady-state\n"
+        << "                          length; queue primitives: capacity (4096)\n"
+        << "      --locks N           false-sharing mode: N locks in an array, each next to\n"
+        << "                          the count it guards; thread i takes lock i % N and\n"
+        << "                          the workload is ignored\n"
+        << "      --lock-padding P    layout of that array: none (packed), line (one cache\n"
+        << "                          line per lock) or pair (two lines, against\n"
+        << "                          adjacent-line prefetch); default none\n"
+        << "      --timeout US        take locks with try_lock_for(US microseconds) and\n"
+        << "                          report the share of attempts that timed out; locks\n"
+        << "                          without timeouts (std-mutex) are run as usual\n"
+        << "      --placement POLICY  pin threads: none, compact, scatter, smt-first or\n"
+        << "                          one-per-socket (default none)\n"
+        << "  -f, --format FORMAT     table, csv or json (default table)\n"
+        << "      --latency           also report p50/p99/p99.9/max latency and per-thread\n"
+        << "                          fairness: lock wait and hold, counter increment,\n"
+        << "                          time inside barrier wait()\n"
+        << "      --perf              also count cycles, instructions, LLC and L1D misses\n"
+        << "                          per operation and context switches, per thread\n"
+        << "      --perf-event rNNNN  with --perf, also count this raw PMU event per\n"
+        << "                          operation, e.g. r04d2 for HITM loads on Skylake and\n"
+        << "                          later (MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM)\n"
+        << "      --save-baseline FILE\n"
+        << "                          save every trial's throughput as a baseline\n"
+        << "      --compare FILE      check the results against a saved baseline and exit\n"
+        << "                          with status 3 if any configuration got slower\n"
+        << "      --alpha P           significance level of that check (default 0.01);\n"
+        << "                          needs enough --trials on both sides to reach it\n"
+        << "      --tolerance PCT     smallest drop of the median throughput that counts\n"
+        << "                          as a regression (default 5)\n"
+        << "      --list              list primitives and exit\n";
+}
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef BENCH_PERF_COUNTERS_H
+#define BENCH_PERF_COUNTERS_H
+
+#include <array>
+#include <optional>
+#include <cstdint>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware performance counters around a benchmark, one set per thread,
+// through Linux perf_event_open. Counters the kernel or CPU does not offer
+// (non-Linux, a VM without a PMU, perf_event_paranoid too strict) are just
+// reported as unavailable; the benchmark runs either way.
+//
+// The generic events cannot see coherence traffic as such: L1D read misses
+// on a contended line are mostly coherence misses, but they also count
+// capacity and cold misses, and they are not HITM (loads served from a
+// line modified in another core's cache). HITM has no generic perf event;
+// it is model-specific, so it is counted as a raw event, given the way
+// perf takes it, e.g. r04d2 (MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM on Skylake
+// and later; see perf list or the SDM for other CPUs).
+
+enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,     // last-level cache misses
+    PERF_L1D_MISSES,       // L1D read misses, any cause
+    PERF_CONTEXT_SWITCHES,
+    PERF_RAW,              // the one raw event asked for, if any
+    PERF_EVENT_COUNT
+};
+
+inline const char* perf_event_name(int event) {
+    static const char* const names[PERF_EVENT_COUNT] = {
+        "cycles", "instructions", "LLC-misses", "L1D-misses", "ctx-switches", "raw"};
+    return names[event];
+}
+
+// A raw PMU event in perf's rNNNN syntax: 'r' and the hexadecimal config,
+// umask in bits 8-15 and event select in bits 0-7 on x86. 0 is no event.
+// Throws std::invalid_argument on anything else.
+inline uint64_t parse_perf_raw_event(const std::string& text) {
+    size_t used = 0;
+    uint64_t config = 0;
+    if (text.size() > 1 && text[0] == 'r') {
+        try {
+            config = std::stoull(text.substr(1), &used, 16);
+        } catch (const std::exception&) {
+            used = 0;
+        }
+    }
+    if (used == 0 || used != text.size() - 1 || config == 0) {
+        throw std::invalid_argument("bad raw perf event " + text + " (expected rNNNN, e.g. r04d2)");
+    }
+    return config;
+}
+
+// Counts from one or more threads. An event is valid only if every thread
+// that contributed managed to count it.
+struct PerfSample {
+    std::array<double, PERF_EVENT_COUNT> values{};
+    std::array<bool, PERF_EVENT_COUNT> valid{};
+    int threads = 0;
+
+    void merge(const PerfSample& other) {
+        for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+            valid[e] = (threads == 0 || valid[e]) && other.valid[e];
+            values[e] += other.values[e];
+        }
+        threads += other.threads;
+    }
+
+    bool any_valid() const {
+        for (bool v : valid) {
+            if (v) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Event count per operation, or a negative value if unavailable.
+    double per_op(int event, double operations) const {
+        return valid[event] && operations > 0 ? values[event] / operations : -1;
+    }
+};
+
+inline PerfSample merge_perf(const std::vector<PerfSample>& samples) {
+    PerfSample merged;
+    for (const PerfSample& s : samples) {
+        merged.merge(s);
+    }
+    return merged;
+}
+
+// "cycles/op 812.4, instructions/op 95.1, ..., ctx-switches 42"; context
+// switches are totals, everything else is per operation. The raw event is
+// shown under rawName, and left out when that is empty.
+inline std::string format_perf(const PerfSample& s, double operations, const std::string& rawName = "") {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        if (e == PERF_RAW && rawName.empty()) {
+            continue;
+        }
+        out << (e == 0 ? "" : ", ") << (e == PERF_RAW ? rawName.c_str() : perf_event_name(e));
+        if (e != PERF_CONTEXT_SWITCHES) {
+            out << "/op";
+        }
+        out << ' ';
+        if (!s.valid[e]) {
+            out << "n/a";
+        } else if (e == PERF_CONTEXT_SWITCHES) {
+            out << std::setprecision(0) << s.values[e] << std::setprecision(2);
+        } else {
+            out << s.per_op(e, operations);
+        }
+    }
+    return out.str();
+}
+
+// The calling thread's counters. Open them on the thread being measured:
+// they count that thread only, in user space except for context switches.
+// rawConfig, if not 0, is a PERF_TYPE_RAW event counted as PERF_RAW.
+class PerfCounters {
+private:
+    std::array<int, PERF_EVENT_COUNT> fds;
+
+#if defined(__linux__)
+    static int open_event(uint32_t type, uint64_t config, bool userOnly) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = userOnly;
+        attr.exclude_hv = 1;
+        // Scaled by enabled/running time if the PMU has to multiplex.
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+
+public:
+    explicit PerfCounters(uint64_t rawConfig = 0) {
+        fds.fill(-1);
+#if defined(__linux__)
+        const uint64_t l1dReadMiss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        fds[PERF_CYCLES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, true);
+        fds[PERF_INSTRUCTIONS] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, true);
+        fds[PERF_CACHE_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, true);
+        fds[PERF_L1D_MISSES] = open_event(PERF_TYPE_HW_CACHE, l1dReadMiss, true);
+        fds[PERF_CONTEXT_SWITCHES] = open_event(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, false);
+        if (rawConfig != 0) {
+            fds[PERF_RAW] = open_event(PERF_TYPE_RAW, rawConfig, true);
+        }
+#else
+        (void)rawConfig;
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters() {
+#if defined(__linux__)
+        for (int fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    void start() {
+#if defined(__linux__)
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    PerfSample stop() {
+        PerfSample sample;
+        sample.threads = 1;
+#if defined(__linux__)
+        for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+            if (fds[e] < 0) {
+                continue;
+            }
+            ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t data[3]; // value, time enabled, time running
+            if (read(fds[e], data, sizeof(data)) == sizeof(data) && data[2] > 0) {
+                sample.values[e] = static_cast<double>(data[0]) * data[1] / data[2];
+                sample.valid[e] = true;
+            }
+        }
+#endif
+        return sample;
+    }
+};
+
+// Counts the enclosing scope on the current thread into *target; does
+// nothing if target is null.
+class PerfScope {
+private:
+    PerfSample* target;
+    std::optional<PerfCounters> counters;
+
+public:
+    explicit PerfScope(PerfSample* target, uint64_t rawConfig = 0) : target(target) {
+        if (target) {
+            counters.emplace(rawConfig);
+            counters->start();
+        }
+    }
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+    ~PerfScope() {
+        if (counters) {
+            *target = counters->stop();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,329 @@
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <ctime>
+#include <cstdio>
+#include "latency.h"
+#include "perf_counters.h"
+
+// One measured configuration.
+struct Result {
+    std::string primitive;
+    std::string kind;
+    std::string workload = "-";     // lock critical-section workload
+    int threads = 0;
+    long operations = 0;
+    double seconds = 0;
+    bool correct = true;
+    std::string placement = "none";
+    std::string cpus = "unpinned";  // thread i ran on the i-th CPU listed
+
+    // operations and seconds are the median trial's; the spread is the
+    // relative standard deviation of throughput over the kept trials.
+    int trials = 1;
+    int rejected = 0;
+    double relativeStddev = 0;
+    std::vector<double> trialThroughput; // operations/second of every timed trial, in run order
+
+    // Only with --latency. wait is lock acquire, counter increment or
+    // barrier wait(); hold is time inside a lock's critical section.
+    bool hasLatency = false;
+    double fairness = 1.0;
+    LatencySummary wait;
+    LatencySummary hold;
+
+    // Only with --timeout, for locks that support it: the share of lock
+    // attempts that gave up, over the timed trials (warmups are left out,
+    // as in the throughput columns). operations counts attempts.
+    bool hasTimeouts = false;
+    double timeoutRate = 0;
+
+    // Only with --perf: counts summed over the timed trials, which ran
+    // perfOperations operations between them.
+    bool hasPerf = false;
+    PerfSample perf;
+    long perfOperations = 0;
+
+    double ops_per_second() const { return seconds > 0 ? operations / seconds : 0; }
+};
+
+// Identifies the machine, so results from different CPU models can be
+// told apart once they are collected.
+struct HostInfo {
+    std::string cpuModel = "unknown";
+    int hardwareThreads = 0;
+    std::string compiler;
+    std::string timestamp;
+
+    static HostInfo detect() {
+        HostInfo host;
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(cpuinfo, line)) {
+            // "model name" on x86, "CPU part"/"Model" on some ARM kernels
+            if (line.rfind("model name", 0) == 0 || line.rfind("Model", 0) == 0) {
+                size_t colon = line.find(':');
+                if (colon != std::string::npos) {
+                    host.cpuModel = line.substr(line.find_first_not_of(" \t", colon + 1));
+                    break;
+                }
+            }
+        }
+        host.hardwareThreads = std::thread::hardware_concurrency();
+#if defined(__clang__)
+        host.compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+        host.compiler = "gcc " __VERSION__;
+#else
+        host.compiler = "unknown";
+#endif
+        std::time_t now = std::time(nullptr);
+        char buffer[32];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+        host.timestamp = buffer;
+        return host;
+    }
+};
+
+inline std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                out += buffer;
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+inline std::string csv_escape(const std::string& s) {
+    if (s.find_first_of(",\"\n") == std::string::npos) {
+        return s;
+    }
+    std::string out = "\"";
+    for (char c : s) {
+        out += c == '"' ? std::string("\"\"") : std::string(1, c);
+    }
+    return out + "\"";
+}
+
+// Streams results as they are produced in the selected format.
+class Reporter {
+private:
+    std::ostream& out;
+    const std::string format;
+    const HostInfo host;
+    const bool latency;
+    const bool timeouts;
+    const bool perf;
+    const std::string rawEvent;     // --perf-event as given, empty: none
+    bool first = true;
+
+    // The events a row shows: every generic one, and the raw one if given.
+    bool shown(int event) const { return event != PERF_RAW || !rawEvent.empty(); }
+
+    static std::string percentiles(const LatencySummary& s) {
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(0) << s.p50 << '/' << s.p99 << '/' << s.p999 << '/' << s.max;
+        return text.str();
+    }
+
+    void csv_latency(const LatencySummary& s) {
+        out << std::fixed << std::setprecision(0) << ',' << s.p50 << ',' << s.p99 << ',' << s.p999 << ','
+            << s.max << std::defaultfloat;
+    }
+
+    void json_latency(const char* name, const LatencySummary& s) {
+        out << ", \"" << name << "_ns\": {" << std::fixed << std::setprecision(0) << "\"p50\": " << s.p50
+            << ", \"p99\": " << s.p99 << ", \"p999\": " << s.p999 << ", \"max\": " << s.max << "}"
+            << std::defaultfloat;
+    }
+
+public:
+    Reporter(std::ostream& out, const std::string& format, const HostInfo& host, bool latency = false,
+             bool timeouts = false, bool perf = false, const std::string& rawEvent = "")
+        : out(out), format(format), host(host), latency(latency), timeouts(timeouts), perf(perf),
+          rawEvent(rawEvent) {}
+
+    void begin() {
+        if (format == "csv") {
+            out << "cpu_model,compiler,timestamp,kind,primitive,workload,threads,placement,cpus,operations,seconds,ops_per_second,correct,trials,rejected,throughput_rsd";
+            if (latency) {
+                out << ",fairness,wait_p50_ns,wait_p99_ns,wait_p999_ns,wait_max_ns"
+                    << ",hold_p50_ns,hold_p99_ns,hold_p999_ns,hold_max_ns";
+            }
+            if (timeouts) {
+                out << ",timeout_rate";
+            }
+            if (perf) {
+                out << ",cycles_per_op,instructions_per_op,llc_misses_per_op,l1d_misses_per_op,context_switches";
+                if (shown(PERF_RAW)) {
+                    out << ',' << rawEvent << "_per_op";
+                }
+            }
+            out << "\n";
+        } else if (format == "json") {
+            out << "{\n  \"host\": {\"cpu_model\": \"" << json_escape(host.cpuModel)
+                << "\", \"hardware_threads\": " << host.hardwareThreads
+                << ", \"compiler\": \"" << json_escape(host.compiler)
+                << "\", \"timestamp\": \"" << host.timestamp << "\"},\n  \"results\": [";
+        } else {
+            out << "CPU: " << host.cpuModel << " (" << host.hardwareThreads << " hardware threads)\n"
+                << std::left << std::setw(10) << "Kind"
+                << std::setw(26) << "Primitive"
+                << std::setw(11) << "Workload"
+                << std::setw(10) << "Threads"
+                << std::setw(16) << "Placement"
+                << std::setw(15) << "Operations"
+                << std::setw(12) << "Time (s)"
+                << std::setw(16) << "Ops/second"
+                << "Correct";
+            if (timeouts) {
+                out << "  " << std::setw(latency ? 11 : 0) << "Timed out";
+            }
+            if (latency) {
+                out << "  " << std::setw(10) << "Fairness"
+                    << std::setw(30) << "Wait p50/p99/p99.9/max (ns)"
+                    << "Hold p50/p99/p99.9/max (ns)";
+            }
+            if (perf) {
+                out << "  Counters";
+            }
+            out << "\n" << std::string((latency ? 190 : 123) + (timeouts ? 11 : 0), '-') << "\n";
+        }
+    }
+
+    void add(const Result& r) {
+        if (format == "csv") {
+            out << csv_escape(host.cpuModel) << ',' << csv_escape(host.compiler) << ',' << host.timestamp << ','
+                << r.kind << ',' << r.primitive << ',' << r.workload << ',' << r.threads << ',' << r.placement << ','
+                << csv_escape(r.cpus) << ',' << r.operations << ','
+                << std::setprecision(6) << r.seconds << ',' << std::fixed << std::setprecision(0)
+                << r.ops_per_second() << std::defaultfloat << ',' << (r.correct ? "true" : "false") << ','
+                << r.trials << ',' << r.rejected << ',' << std::setprecision(4) << r.relativeStddev;
+            if (latency) {
+                out << ',' << std::setprecision(4) << r.fairness;
+                csv_latency(r.wait);
+                csv_latency(r.hold);
+            }
+            if (timeouts) {
+                out << ',';
+                if (r.hasTimeouts) {
+                    out << std::setprecision(4) << r.timeoutRate;
+                }
+            }
+            if (perf) {
+                // empty where unavailable, like timeout_rate
+                for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+                    if (!shown(e)) {
+                        continue;
+                    }
+                    out << ',';
+                    if (r.hasPerf && r.perf.valid[e]) {
+                        out << std::fixed << std::setprecision(e == PERF_CONTEXT_SWITCHES ? 0 : 2)
+                            << (e == PERF_CONTEXT_SWITCHES ? r.perf.values[e] : r.perf.per_op(e, r.perfOperations))
+                            << std::defaultfloat;
+                    }
+                }
+            }
+            out << '\n';
+        } else if (format == "json") {
+            out << (first ? "\n" : ",\n")
+                << "    {\"kind\": \"" << r.kind << "\", \"primitive\": \"" << json_escape(r.primitive)
+                << "\", \"workload\": \"" << r.workload << "\", \"threads\": " << r.threads << ", \"placement\": \"" << r.placement
+                << "\", \"cpus\": [" << (r.cpus == "unpinned" ? "" : r.cpus) << "]"
+                << ", \"operations\": " << r.operations
+                << ", \"seconds\": " << std::setprecision(6) << r.seconds
+                << ", \"ops_per_second\": " << std::fixed << std::setprecision(0) << r.ops_per_second()
+                << std::defaultfloat << ", \"correct\": " << (r.correct ? "true" : "false")
+                << ", \"trials\": " << r.trials << ", \"rejected\": " << r.rejected
+                << ", \"throughput_rsd\": " << std::setprecision(4) << r.relativeStddev;
+            if (latency) {
+                out << ", \"fairness\": " << std::setprecision(4) << r.fairness;
+                json_latency("wait", r.wait);
+                json_latency("hold", r.hold);
+            }
+            if (timeouts && r.hasTimeouts) {
+                out << ", \"timeout_rate\": " << std::setprecision(4) << r.timeoutRate;
+            }
+            if (perf && r.hasPerf) {
+                // per operation except context switches; null where unavailable
+                static const char* const keys[PERF_EVENT_COUNT] = {
+                    "cycles_per_op", "instructions_per_op", "llc_misses_per_op",
+                    "l1d_misses_per_op", "context_switches", nullptr};
+                out << ", \"perf\": {";
+                const char* separator = "";
+                for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+                    if (!shown(e)) {
+                        continue;
+                    }
+                    out << separator << '"' << (keys[e] ? keys[e] : json_escape(rawEvent + "_per_op").c_str()) << "\": ";
+                    if (!r.perf.valid[e]) {
+                        out << "null";
+                    } else {
+                        out << std::fixed << std::setprecision(e == PERF_CONTEXT_SWITCHES ? 0 : 2)
+                            << (e == PERF_CONTEXT_SWITCHES ? r.perf.values[e] : r.perf.per_op(e, r.perfOperations))
+                            << std::defaultfloat;
+                    }
+                    separator = ", ";
+                }
+                out << "}";
+            }
+            out << "}";
+        } else {
+            out << std::left << std::setw(10) << r.kind
+                << std::setw(26) << r.primitive
+                << std::setw(11) << r.workload
+                << std::setw(10) << r.threads
+                << std::setw(16) << r.placement
+                << std::setw(15) << r.operations
+                << std::fixed << std::setprecision(4) << std::setw(12) << r.seconds
+                << std::setprecision(0) << std::setw(16) << r.ops_per_second()
+                << std::defaultfloat << std::setw(latency || timeouts || perf ? 9 : 0) << (r.correct ? "yes" : "NO");
+            if (timeouts) {
+                std::ostringstream rate;
+                if (r.hasTimeouts) {
+                    rate << std::fixed << std::setprecision(2) << 100 * r.timeoutRate << '%';
+                } else {
+                    rate << '-';
+                }
+                out << std::setw(latency ? 13 : 0) << rate.str();
+            }
+            if (latency) {
+                out << std::fixed << std::setprecision(3) << std::setw(10) << r.fairness
+                    << std::setw(30) << percentiles(r.wait) << percentiles(r.hold) << std::defaultfloat;
+            }
+            if (perf) {
+                out << (latency || timeouts ? "  " : "") << (r.hasPerf ? format_perf(r.perf, r.perfOperations, rawEvent) : "-");
+            }
+            out << "\n";
+        }
+        first = false;
+        out.flush();
+    }
+
+    void end() {
+        if (format == "json") {
+            out << "\n  ]\n}\n";
+        }
+    }
+};
+
+#endif
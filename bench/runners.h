@@ -0,0 +1,475 @@
+#ifndef BENCH_RUNNERS_H
+#define BENCH_RUNNERS_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <barrier>
+#include <optional>
+#include <memory>
+#include "options.h"
+#include "report.h"
+#include "workload.h"
+#include "harness.h"
+
+inline ThreadPlan thread_plan(const Options& options, int numThreads) {
+    return {numThreads, placement_cpus(options.placement, numThreads), options.iterations, options.duration};
+}
+
+inline TrialOptions trial_options(const Options& options) {
+    TrialOptions trials;
+    trials.warmup = options.warmup;
+    trials.trials = options.trials;
+    trials.latency = options.latency;
+    trials.perf = options.perf;
+    trials.perfRawEvent = options.perfRawEvent;
+    return trials;
+}
+
+// The fields of a Result every trial-based runner fills the same way.
+inline Result trial_result(const char* kind, const Options& options, const RunResult& run) {
+    Result r;
+    r.kind = kind;
+    r.threads = run.threads;
+    r.operations = run.operations;
+    r.seconds = run.seconds;
+    r.trials = static_cast<int>(run.trials.size());
+    r.rejected = run.rejected;
+    r.relativeStddev = run.relative_stddev();
+    for (const Measurement& m : run.trials) {
+        r.trialThroughput.push_back(m.throughput());
+    }
+    r.placement = placement_name(options.placement);
+    r.cpus = describe_cpus(run.cpus);
+    r.correct = run.correct;
+    if (run.hasLatency) {
+        ThreadLatency merged = merge_latency(run.latency);
+        r.hasLatency = true;
+        r.fairness = jain_fairness(run.latency);
+        r.wait = LatencySummary::of(merged.wait);
+        r.hold = LatencySummary::of(merged.hold);
+    }
+    if (run.hasPerf) {
+        r.hasPerf = true;
+        r.perf = run.perf;
+        r.perfOperations = run.measuredOperations;
+    }
+    return r;
+}
+
+// --timeout: every lock attempt of a run is made with try_lock_for() and
+// may give up. Counts attempts and give-ups over the timed trials, as the
+// throughput numbers do, and the give-ups of the current trial, which took
+// no lock and so added nothing.
+class LockTimeouts {
+private:
+    const std::chrono::nanoseconds timeout;
+    const int warmup;
+    int trial = 0;
+    std::atomic<long> trialGaveUp{0};
+    long attempts = 0;
+    long gaveUp = 0;
+
+public:
+    explicit LockTimeouts(const Options& options)
+        : timeout(std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::duration<double, std::micro>(options.timeout))),
+          warmup(options.warmup) {}
+
+    template <typename LockType>
+    static constexpr bool supported() { return TimedLockable<LockType>; }
+
+    bool enabled() const { return timeout.count() > 0; }
+
+    // One operation's lock, section(), unlock; false if it gave up.
+    template <typename LockType, typename Section>
+    bool run_locked(LockType& lock, ThreadLatency* stats, Section& section) {
+        if constexpr (supported<LockType>()) {
+            if (enabled()) {
+                return run_locked_for(lock, timeout, stats, section);
+            }
+        }
+        ::run_locked(lock, stats, section);
+        return true;
+    }
+
+    // Called before every trial, warmups included, in run_trials() order.
+    void prepare() {
+        trialGaveUp = 0;
+        trial++;
+    }
+    void add(long threadGaveUp) { trialGaveUp.fetch_add(threadGaveUp, std::memory_order_relaxed); }
+
+    // Acquisitions the trial's operations made; also tallies the trial
+    // unless it was a warmup.
+    long acquired(long operations) {
+        if (trial > warmup) {
+            attempts += operations;
+            gaveUp += trialGaveUp.load();
+        }
+        return operations - trialGaveUp.load();
+    }
+
+    template <typename LockType>
+    void report(Result& r) const {
+        if (enabled() && supported<LockType>()) {
+            r.hasTimeouts = true;
+            r.timeoutRate = attempts > 0 ? static_cast<double>(gaveUp) / attempts : 0;
+        }
+    }
+};
+
+// False-sharing mode: options.locks locks in an array, each followed by
+// the count it guards and laid out with Padding. Thread i only ever takes
+// lock i % locks, so with at least as many locks as threads no lock is
+// shared and whatever the packed layout loses to the padded ones is false
+// sharing. Each operation is lock, increment, critical-section work,
+// unlock, then think time. Correct if every count adds up.
+template <typename LockType, typename Padding>
+Result run_lock_array(const Options& options, int numThreads) {
+    struct Guarded {
+        LockType lock;
+        long count = 0;
+    };
+    std::unique_ptr<Padded<Guarded, Padding>[]> slots(new Padded<Guarded, Padding>[options.locks]);
+    LockTimeouts timeouts(options);
+
+    RunResult run = run_trials(
+        thread_plan(options, numThreads), trial_options(options),
+        [&]() {
+            for (int i = 0; i < options.locks; i++) {
+                slots[i].value.count = 0;
+            }
+            timeouts.prepare();
+        },
+        [&](int id, auto more, ThreadLatency* stats) {
+            Guarded& mine = slots[id % options.locks].value;
+            auto section = [&]() {
+                mine.count++;
+                busy_work(options.criticalSection);
+            };
+            ThinkTime think(options, id);
+            long done = 0;
+            long gaveUp = 0;
+            for (; more(done); done++) {
+                gaveUp += !timeouts.run_locked(mine.lock, stats, section);
+                think();
+            }
+            timeouts.add(gaveUp);
+            return done;
+        },
+        [&](long operations) {
+            long total = 0;
+            for (int i = 0; i < options.locks; i++) {
+                total += slots[i].value.count;
+            }
+            return total == timeouts.acquired(operations);
+        });
+
+    Result r = trial_result("lock", options, run);
+    r.workload = "array-" + options.lockPadding;
+    timeouts.report<LockType>(r);
+    return r;
+}
+
+// Lock: each operation is lock, increment a shared value, the workload's
+// critical section, unlock, then think time. Correct if no increment is
+// lost. With --locks, runs run_lock_array() instead; with --timeout, an
+// operation that gives up on the lock skips the rest.
+template <typename LockType>
+Result run_lock(const Options& options, int numThreads) {
+    if (options.locks > 1) {
+        if (options.lockPadding == "line") {
+            return run_lock_array<LockType, CacheLinePadding>(options, numThreads);
+        }
+        if (options.lockPadding == "pair") {
+            return run_lock_array<LockType, AdjacentLinePadding>(options, numThreads);
+        }
+        return run_lock_array<LockType, NoPadding>(options, numThreads);
+    }
+
+    LockType lock;
+    long shared = 0;
+    LockTimeouts timeouts(options);
+
+    RunResult run = with_workload(options, [&](auto& workload) {
+        auto critical = [&](auto& state) {
+            shared++;
+            workload.critical(state);
+        };
+        return run_trials(
+            thread_plan(options, numThreads), trial_options(options),
+            [&]() {
+                shared = 0;
+                timeouts.prepare();
+            },
+            [&](int id, auto more, ThreadLatency* stats) {
+                auto state = workload.thread_state(id);
+                auto section = [&]() { critical(state); };
+                ThinkTime think(options, id);
+                long done = 0;
+                long gaveUp = 0;
+                for (; more(done); done++) {
+                    gaveUp += !timeouts.run_locked(lock, stats, section);
+                    think();
+                }
+                timeouts.add(gaveUp);
+                return done;
+            },
+            [&](long operations) { return shared == timeouts.acquired(operations); });
+    });
+
+    Result r = trial_result("lock", options, run);
+    r.workload = options.workload;
+    timeouts.report<LockType>(r);
+    return r;
+}
+
+// Counter: each operation is one increment plus think time. Every trial
+// gets a fresh counter.
+template <typename CounterType>
+Result run_counter(const Options& options, int numThreads) {
+    std::optional<CounterType> counter;
+
+    RunResult run = run_trials(
+        thread_plan(options, numThreads), trial_options(options), [&]() { counter.emplace(); },
+        [&](int id, auto more, ThreadLatency* stats) {
+            ThinkTime think(options, id);
+            long done = 0;
+            for (; more(done); done++) {
+                if (stats != nullptr) {
+                    uint64_t before = read_ticks();
+                    counter->increment();
+                    stats->wait.record(read_ticks() - before);
+                } else {
+                    counter->increment();
+                }
+                think();
+            }
+            return done;
+        },
+        [&](long operations) { return counter->get() == operations; });
+
+    return trial_result("counter", options, run);
+}
+
+// Barrier: each operation is one phase (outside units of work, then wait()
+// on every thread). In timed runs all threads must agree on when to stop,
+// or the ones that keep going wait forever: every batch of phases ends with
+// an extra phase after thread 0 has published its decision.
+template <typename BarrierType>
+Result run_barrier(const Options& options, int numThreads) {
+    const long batch = 1024;
+    BarrierType barrier(numThreads);
+    std::atomic<bool> keepRunning{true};
+    std::atomic<long> phases{0};
+
+    RunResult run = run_trials(
+        thread_plan(options, numThreads), trial_options(options), [&]() { keepRunning = true; },
+        [&](int id, auto more, ThreadLatency* stats) {
+            long done = 0;
+            while (true) {
+                long todo = options.duration > 0 ? batch : options.iterations;
+                for (long j = 0; j < todo; j++) {
+                    busy_work(options.outsideWork);
+                    if (stats != nullptr) {
+                        uint64_t arrived = read_ticks();
+                        barrier.wait();
+                        stats->wait.record(read_ticks() - arrived);
+                    } else {
+                        barrier.wait();
+                    }
+                }
+                done += todo;
+                if (options.duration <= 0) {
+                    break;
+                }
+
+                if (id == 0) {
+                    keepRunning.store(more(done), std::memory_order_relaxed);
+                }
+                barrier.wait();
+                done++;
+                if (!keepRunning.load(std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            if (id == 0) {
+                phases.store(done, std::memory_order_relaxed);
+            }
+            return done;
+        },
+        // every thread must have passed every phase
+        [&](long operations) { return operations == numThreads * phases.load(); });
+
+    Result r = trial_result("barrier", options, run);
+    r.operations = run.operations / numThreads;
+    return r;
+}
+
+// Spins, then yields, while a queue is full or empty, so the thread it
+// waits for can run even when the two share a core.
+inline void queue_wait(unsigned& rounds) {
+    if (++rounds < 128) {
+        cpu_relax();
+    } else {
+        std::this_thread::yield();
+    }
+}
+
+// Queue: half the threads, rounded down, push into a queue of --size
+// capacity and the rest pop from it, with --cs units of work per popped
+// item, so numThreads must be at least 2; the driver skips smaller counts.
+// Each operation is one item through the queue. The last producer to
+// finish pushes an end marker per consumer. Correct if the values popped
+// add up to the values pushed.
+template <typename QueueType>
+Result run_queue(const Options& options, int numThreads) {
+    const int producers = numThreads / 2;
+    const int consumers = numThreads - producers;
+    const uint64_t END = 0;
+    std::unique_ptr<QueueType> queue;
+    std::atomic<int> producing{0};
+    std::atomic<uint64_t> pushedSum{0};
+    std::atomic<uint64_t> poppedSum{0};
+
+    // every thread does not record the same kind of operation
+    TrialOptions trials = trial_options(options);
+    trials.latency = false;
+
+    RunResult run = run_trials(
+        thread_plan(options, producers + consumers), trials,
+        [&]() {
+            queue = std::make_unique<QueueType>(std::max(1L, options.workloadSize));
+            producing = producers;
+            pushedSum = 0;
+            poppedSum = 0;
+        },
+        [&](int id, auto more, ThreadLatency*) {
+            unsigned rounds = 0;
+            if (id < producers) {
+                ThinkTime think(options, id);
+                uint64_t sum = 0;
+                long done = 0;
+                for (; more(done); done++) {
+                    uint64_t value = (static_cast<uint64_t>(id) << 40) + done + 1;
+                    for (rounds = 0; !queue->try_push(value);) {
+                        queue_wait(rounds);
+                    }
+                    sum += value;
+                    think();
+                }
+                pushedSum += sum;
+                if (producing.fetch_sub(1) == 1) {
+                    for (int c = 0; c < consumers; c++) {
+                        for (rounds = 0; !queue->try_push(END);) {
+                            queue_wait(rounds);
+                        }
+                    }
+                }
+                return done;
+            }
+
+            uint64_t sum = 0;
+            uint64_t value;
+            while (true) {
+                if (!queue->try_pop(value)) {
+                    queue_wait(rounds);
+                    continue;
+                }
+                rounds = 0;
+                if (value == END) {
+                    break;
+                }
+                sum += value;
+                busy_work(options.criticalSection);
+            }
+            poppedSum += sum;
+            return 0L;
+        },
+        [&](long) { return pushedSum == poppedSum; });
+
+    return trial_result("queue", options, run);
+}
+
+// Work stealing: thread 0 owns the deque and spawns every task, pushing
+// batches of 32 and popping them back; every other thread steals. A task is
+// --cs units of work. Each operation is one task run. Correct if every
+// task ran exactly once.
+template <typename DequeType>
+Result run_deque(const Options& options, int numThreads) {
+    const long batch = 32;
+    std::unique_ptr<DequeType> deque;
+    std::atomic<bool> spawning{true};
+    std::atomic<uint64_t> spawnedSum{0};
+    std::atomic<uint64_t> ranSum{0};
+
+    TrialOptions trials = trial_options(options);
+    trials.latency = false;
+
+    RunResult run = run_trials(
+        thread_plan(options, numThreads), trials,
+        [&]() {
+            deque = std::make_unique<DequeType>();
+            spawning = true;
+            spawnedSum = 0;
+            ranSum = 0;
+        },
+        [&](int id, auto more, ThreadLatency*) {
+            uint64_t sum = 0;
+            long ran = 0;
+            uint64_t task;
+            auto run_task = [&](uint64_t value) {
+                busy_work(options.criticalSection);
+                sum += value;
+                ran++;
+            };
+
+            if (id == 0) {
+                // the fixed-count plan is per thread: thread 0 spawns everyone's share
+                uint64_t spawned = 0;
+                uint64_t spawnedValues = 0;
+                while (more(static_cast<long>(spawned / numThreads))) {
+                    for (long k = 0; k < batch; k++) {
+                        deque->push(++spawned);
+                        spawnedValues += spawned;
+                    }
+                    while (deque->pop(task)) {
+                        run_task(task);
+                    }
+                }
+                spawnedSum = spawnedValues;
+                spawning.store(false, std::memory_order_release);
+            } else {
+                unsigned rounds = 0;
+                while (true) {
+                    if (deque->steal(task)) {
+                        run_task(task);
+                        rounds = 0;
+                    } else if (!spawning.load(std::memory_order_acquire) && deque->empty()) {
+                        break;
+                    } else {
+                        queue_wait(rounds);
+                    }
+                }
+            }
+            ranSum += sum;
+            return ran;
+        },
+        [&](long) { return spawnedSum == ranSum; });
+
+    return trial_result("deque", options, run);
+}
+
+// std::barrier behind the wait() interface the runners expect.
+class StdBarrier {
+private:
+    std::barrier<> barrier;
+
+public:
+    explicit StdBarrier(int n) : barrier(n) {}
+    void wait() { barrier.arrive_and_wait(); }
+};
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef BENCH_STATS_H
+#define BENCH_STATS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Two-sample statistics for comparing a run against a baseline: the
+// Mann-Whitney U test, which assumes nothing about the shape of the
+// throughput distribution (trials are often skewed and have outliers),
+// and a bootstrap confidence interval for the change in the median.
+
+inline double median_of(std::vector<double> values) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+// One-sided Mann-Whitney U test of "x tends to be smaller than y".
+// u counts the pairs with x_i > y_j, ties as one half, so it is small when
+// x is smaller; p is the probability of a u that small if both samples
+// came from the same distribution. Exact for small samples without ties,
+// otherwise the normal approximation with tie and continuity corrections.
+struct MannWhitney {
+    double u = 0;
+    double p = 1;
+};
+
+inline MannWhitney mann_whitney_less(const std::vector<double>& x, const std::vector<double>& y) {
+    MannWhitney result;
+    const size_t n = x.size();
+    const size_t m = y.size();
+    if (n == 0 || m == 0) {
+        return result;
+    }
+
+    bool ties = false;
+    for (double a : x) {
+        for (double b : y) {
+            result.u += a > b ? 1 : a == b ? 0.5 : 0;
+            ties = ties || a == b;
+        }
+    }
+
+    if (!ties && n <= 25 && m <= 25) {
+        // ways[i][j][u]: orderings of i x's and j y's with u pairs x > y.
+        // The largest element is an x (beating all j y's) or a y.
+        const size_t maxU = n * m;
+        std::vector<std::vector<std::vector<double>>> ways(
+            n + 1, std::vector<std::vector<double>>(m + 1, std::vector<double>(maxU + 1, 0)));
+        for (size_t i = 0; i <= n; i++) {
+            for (size_t j = 0; j <= m; j++) {
+                if (i == 0 || j == 0) {
+                    ways[i][j][0] = 1;
+                    continue;
+                }
+                for (size_t u = 0; u <= i * j; u++) {
+                    ways[i][j][u] = (u >= j ? ways[i - 1][j][u - j] : 0) + ways[i][j - 1][u];
+                }
+            }
+        }
+        double total = 0;
+        double atMost = 0;
+        for (size_t u = 0; u <= maxU; u++) {
+            total += ways[n][m][u];
+            atMost += u <= result.u ? ways[n][m][u] : 0;
+        }
+        result.p = atMost / total;
+        return result;
+    }
+
+    // Tie correction: sum of t^3 - t over groups of equal values.
+    std::vector<double> all(x);
+    all.insert(all.end(), y.begin(), y.end());
+    std::sort(all.begin(), all.end());
+    double tieTerm = 0;
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j] == all[i]) {
+            j++;
+        }
+        double t = static_cast<double>(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+    const double N = static_cast<double>(n + m);
+    const double mean = n * m / 2.0;
+    const double variance = n * m / 12.0 * ((N + 1) - tieTerm / (N * (N - 1)));
+    if (variance <= 0) {
+        return result; // every value equal: no evidence either way
+    }
+    double z = (result.u + 0.5 - mean) / std::sqrt(variance);
+    result.p = 0.5 * std::erfc(-z / std::sqrt(2.0));
+    return result;
+}
+
+// Percentile bootstrap interval for median(current) / median(baseline) - 1,
+// resampling both sides. Seeded, so the same samples give the same
+// interval on every run.
+struct ChangeInterval {
+    double low = 0;
+    double high = 0;
+};
+
+inline ChangeInterval bootstrap_median_change(const std::vector<double>& current, const std::vector<double>& baseline,
+                                              double confidence = 0.95, int resamples = 2000) {
+    ChangeInterval interval;
+    if (current.empty() || baseline.empty()) {
+        return interval;
+    }
+
+    std::mt19937_64 rng(0x5eed);
+    auto resample = [&](const std::vector<double>& sample) {
+        std::uniform_int_distribution<size_t> pick(0, sample.size() - 1);
+        std::vector<double> drawn(sample.size());
+        for (double& v : drawn) {
+            v = sample[pick(rng)];
+        }
+        return median_of(std::move(drawn));
+    };
+
+    std::vector<double> changes;
+    changes.reserve(resamples);
+    for (int i = 0; i < resamples; i++) {
+        double base = resample(baseline);
+        if (base > 0) {
+            changes.push_back(resample(current) / base - 1);
+        }
+    }
+    if (changes.empty()) {
+        return interval;
+    }
+    std::sort(changes.begin(), changes.end());
+    double tail = (1 - confidence) / 2;
+    auto at = [&](double q) { return changes[static_cast<size_t>(q * (changes.size() - 1) + 0.5)]; };
+    interval.low = at(tail);
+    interval.high = at(1 - tail);
+    return interval;
+}
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef BENCH_WORKLOAD_H
+#define BENCH_WORKLOAD_H
+
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "options.h"
+#include "../sync/config.h"
+
+// What a lock benchmark does inside and between its critical sections.
+// A workload has per-thread state made by thread_state(id) and a
+// critical(state) step that runs with the lock held; ThinkTime supplies
+// the gap until the next acquire. run_lock picks the workload once per run,
+// so the measured loop calls it without any indirection.
+
+// Burns roughly `units` loop iterations the optimizer cannot remove.
+inline void busy_work(long units) {
+    for (long i = 0; i < units; i++) {
+        asm volatile("");
+    }
+}
+
+// Keeps value alive without storing it anywhere.
+inline void keep(uint64_t value) {
+    asm volatile("" : : "r"(value));
+}
+
+// Per-thread xorshift64*: cheap enough to call in the critical section.
+class WorkloadRandom {
+private:
+    uint64_t state;
+
+public:
+    explicit WorkloadRandom(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ull + 1) {}
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+
+    // Uniform in [0, 1).
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+    // Uniform in [0, bound).
+    uint64_t below(uint64_t bound) { return next() % bound; }
+};
+
+// Think time between a release and the next acquire: the fixed --outside
+// units plus, with --think MEAN, an exponentially distributed number of
+// units with that mean, so acquisitions arrive as a Poisson process.
+class ThinkTime {
+private:
+    const long fixed;
+    const double mean;
+    WorkloadRandom random;
+
+public:
+    ThinkTime(const Options& options, int thread)
+        : fixed(options.outsideWork), mean(options.think), random(thread * 2 + 1) {}
+
+    void operator()() {
+        long units = fixed;
+        if (mean > 0) {
+            units += static_cast<long>(-std::log(1.0 - random.uniform()) * mean);
+        }
+        busy_work(units);
+    }
+};
+
+// Only the benchmark's own shared counter, plus --cs units of work.
+class CounterWorkload {
+private:
+    const int criticalSection;
+
+public:
+    struct Thread {};
+
+    explicit CounterWorkload(const Options& options) : criticalSection(options.criticalSection) {}
+
+    Thread thread_state(int) { return {}; }
+
+    void critical(Thread&) { busy_work(criticalSection); }
+};
+
+// Touches --lines shared cache lines per critical section; each touch is a
+// write with probability --write-percent, otherwise a read. Writes make
+// every line migrate between the cores taking the lock, as real protected
+// data does.
+class FootprintWorkload {
+private:
+    struct alignas(CACHE_LINE_SIZE) Line {
+        uint64_t words[CACHE_LINE_SIZE / sizeof(uint64_t)] = {};
+    };
+
+    const int numLines;
+    const int writePercent;
+    const int criticalSection;
+    std::unique_ptr<Line[]> lines;
+
+public:
+    struct Thread {
+        WorkloadRandom random;
+    };
+
+    explicit FootprintWorkload(const Options& options)
+        : numLines(std::max(1, options.lines)), writePercent(options.writePercent),
+          criticalSection(options.criticalSection), lines(new Line[numLines]) {}
+
+    Thread thread_state(int id) { return {WorkloadRandom(id + 1)}; }
+
+    void critical(Thread& t) {
+        uint64_t sum = 0;
+        for (int i = 0; i < numLines; i++) {
+            if (static_cast<int>(t.random.below(100)) < writePercent) {
+                lines[i].words[0]++;
+            } else {
+                sum += lines[i].words[0];
+            }
+        }
+        keep(sum);
+        busy_work(criticalSection);
+    }
+};
+
+// Increments the value of a random key among --size keys in a shared
+// std::unordered_map: inserts until every key exists, then updates.
+class HashMapWorkload {
+private:
+    const uint64_t keys;
+    const int criticalSection;
+    std::unordered_map<uint64_t, uint64_t> map;
+
+public:
+    struct Thread {
+        WorkloadRandom random;
+    };
+
+    explicit HashMapWorkload(const Options& options)
+        : keys(std::max(1L, options.workloadSize)), criticalSection(options.criticalSection) {
+        map.reserve(keys);
+    }
+
+    Thread thread_state(int id) { return {WorkloadRandom(id + 1)}; }
+
+    void critical(Thread& t) {
+        map[t.random.below(keys)]++;
+        busy_work(criticalSection);
+    }
+};
+
+// Pushes onto a shared std::deque and pops the oldest element once it
+// holds --size elements, like a producer/consumer queue at steady state.
+class QueueWorkload {
+private:
+    const size_t capacity;
+    const int criticalSection;
+    std::deque<uint64_t> queue;
+
+public:
+    struct Thread {
+        uint64_t next = 0;
+    };
+
+    explicit QueueWorkload(const Options& options)
+        : capacity(std::max(1L, options.workloadSize)), criticalSection(options.criticalSection) {}
+
+    Thread thread_state(int) { return {}; }
+
+    void critical(Thread& t) {
+        queue.push_back(t.next++);
+        if (queue.size() > capacity) {
+            keep(queue.front());
+            queue.pop_front();
+        }
+        busy_work(criticalSection);
+    }
+};
+
+// Calls f(workload) with the workload options.workload names (one of
+// WORKLOAD_NAMES). Throws std::invalid_argument for an unknown name.
+template <typename F>
+auto with_workload(const Options& options, F f) {
+    if (options.workload == "footprint") {
+        FootprintWorkload w(options);
+        return f(w);
+    } else if (options.workload == "hashmap") {
+        HashMapWorkload w(options);
+        return f(w);
+    } else if (options.workload == "queue") {
+        QueueWorkload w(options);
+        return f(w);
+    } else if (options.workload == "counter") {
+        CounterWorkload w(options);
+        return f(w);
+    }
+    throw std::invalid_argument("unknown workload " + options.workload);
+}
+
+#endif
@@ -8,7 +8,15 @@
 #include <algorithm>
 #include <iomanip>
 #include <cassert>
+#include <shared_mutex>
 #include "lock.h"
+#include "../sync/rwlock.h"
+#include "../sync/combining.h"
+#include "../sync/delegation.h"
+#include "../sync/queue.h"
+#include "../sync/stack.h"
+#include "../sync/profile.h"
+#include "../sync/elision.h"
 
 
 class Counter {
@@ -32,11 +40,9 @@ void test_correctness(LockType& lock, int num_threads, int iterations_per_thread
 
     auto worker = [&](int id) {
         for (int i = 0; i < iterations_per_thread; i++) {
-            if constexpr (std::is_same_v<LockType, MCSLock>) {
-                MCSLock::Node node;
-                lock.lock(node);
+            if constexpr (requires { typename LockType::Node; }) {
+                MCSLockGuard<LockType> guard(lock);
                 counter.increment();
-                lock.unlock(node);
             } else {
                 lock.lock();
                 counter.increment();
@@ -66,6 +72,393 @@ void test_correctness(LockType& lock, int num_threads, int iterations_per_thread
     assert(expected == actual);
 }
 
+// Writers keep two fields equal under the exclusive lock; readers holding
+// the shared lock must never see them differ.
+template<typename LockType>
+void test_rw_correctness(LockType& lock, int num_readers, int num_writers, int iterations_per_thread) {
+    int first = 0;
+    int second = 0;
+    std::atomic<int> torn_reads{0};
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < num_writers; i++) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < iterations_per_thread; j++) {
+                std::lock_guard<LockType> guard(lock);
+                first++;
+                second++;
+            }
+        });
+    }
+
+    for (int i = 0; i < num_readers; i++) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < iterations_per_thread; j++) {
+                std::shared_lock<LockType> guard(lock);
+                if (first != second) {
+                    torn_reads++;
+                }
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    int expected = num_writers * iterations_per_thread;
+    bool passed = first == expected && second == expected && torn_reads == 0;
+
+    std::cout << "Correctness test for "
+              << typeid(LockType).name() << ": "
+              << (passed ? "PASSED" : "FAILED")
+              << " (Expected: " << expected << ", Actual: " << first
+              << ", Torn reads: " << torn_reads << ")"
+              << std::endl;
+
+    assert(passed);
+}
+
+// The TimedLockable side. While a helper thread holds the lock, try_lock()
+// and an expired try_lock_until() must fail at once and try_lock_for() only
+// once its timeout has passed; reader-writer locks must also refuse
+// readers. Then threads mix lock(), try_lock() and short try_lock_for()
+// calls, timing out often, and every acquisition that succeeded must have
+// been exclusive. Reader-writer locks also run blocking readers against
+// writers that mix try_lock() and lock(), so failed tries land between
+// writer phases that readers are still waiting out.
+template<typename LockType>
+void test_try_lock_correctness(const std::string& name, int num_threads, int iterations_per_thread) {
+    LockType lock;
+    std::atomic<int> stage{0};
+    bool refused = true;
+
+    std::thread holder([&]() {
+        lock.lock();
+        stage.store(1);
+        while (stage.load() != 2) {
+            std::this_thread::yield();
+        }
+        lock.unlock();
+        stage.store(3);
+    });
+    while (stage.load() != 1) {
+        std::this_thread::yield();
+    }
+    auto timeout = std::chrono::milliseconds(2);
+    auto before = std::chrono::steady_clock::now();
+    refused = !lock.try_lock() && !lock.try_lock_until(before) && !lock.try_lock_for(timeout);
+    refused = refused && std::chrono::steady_clock::now() - before >= timeout;
+    if constexpr (SharedTimedLockable<LockType>) {
+        refused = refused && !lock.try_lock_shared() && !lock.try_lock_shared_for(timeout);
+    }
+    stage.store(2);
+    while (stage.load() != 3) {
+        std::this_thread::yield();
+    }
+    holder.join();
+    bool free_again = lock.try_lock();
+    if (free_again) {
+        lock.unlock();
+    }
+
+    int counter = 0;
+    std::atomic<int> acquired{0};
+    std::atomic<int> timed_out{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < iterations_per_thread; i++) {
+                bool got = true;
+                if (i % 3 == 0) {
+                    lock.lock();
+                } else if (i % 3 == 1) {
+                    got = lock.try_lock();
+                } else {
+                    got = lock.try_lock_for(std::chrono::microseconds(20));
+                }
+                if (got) {
+                    counter++;
+                    if (i % 64 == 0) {
+                        std::this_thread::yield(); // let the others queue up and give up
+                    }
+                    lock.unlock();
+                    acquired++;
+                } else {
+                    timed_out++;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    bool passed = refused && free_again && counter == acquired.load() &&
+                  acquired + timed_out == num_threads * iterations_per_thread;
+
+    int torn_reads = 0;
+    if constexpr (SharedLockable<LockType>) {
+        int first = 0;
+        int second = 0;
+        std::atomic<int> written{0};
+        std::atomic<int> torn{0};
+        threads.clear();
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&]() {
+                for (int i = 0; i < iterations_per_thread; i++) {
+                    lock.lock_shared();
+                    if (first != second) {
+                        torn++;
+                    }
+                    lock.unlock_shared();
+                }
+            });
+            threads.emplace_back([&, t]() {
+                for (int i = 0; i < iterations_per_thread; i++) {
+                    if (t % 2 == 0) {
+                        lock.lock();
+                    } else if (!lock.try_lock()) {
+                        continue;
+                    }
+                    first++;
+                    second++;
+                    lock.unlock();
+                    written++;
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        torn_reads = torn.load();
+        passed = passed && torn_reads == 0 && first == written.load() && second == written.load();
+    }
+
+    std::cout << "Try-lock test for " << name << ": " << (passed ? "PASSED" : "FAILED")
+              << " (Acquired: " << acquired << ", Counted: " << counter
+              << ", Gave up: " << timed_out;
+    if constexpr (SharedLockable<LockType>) {
+        std::cout << ", Torn reads: " << torn_reads;
+    }
+    std::cout << ")" << std::endl;
+
+    assert(passed);
+}
+
+// Hand-over-hand through three locks with the BasicLockable interface:
+// take A, then B, drop A, take C, drop B, drop C. Each thread holds two
+// locks at once and releases them out of order, so each needs its own
+// queue node per lock. Every counter must see every increment.
+template<typename LockType>
+void test_nested_correctness(const std::string& name, int num_threads, int iterations_per_thread) {
+    LockType a, b, c;
+    int in_a = 0, in_b = 0, in_c = 0;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < iterations_per_thread; i++) {
+                a.lock();
+                in_a++;
+                b.lock();
+                in_b++;
+                a.unlock();
+                c.lock();
+                in_c++;
+                b.unlock();
+                c.unlock();
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    int expected = num_threads * iterations_per_thread;
+    bool passed = in_a == expected && in_b == expected && in_c == expected;
+    std::cout << "Nested acquisition test for " << name << ": " << (passed ? "PASSED" : "FAILED")
+              << " (Expected: " << expected << " per lock, Actual: " << in_a << "/" << in_b << "/" << in_c << ")"
+              << std::endl;
+
+    assert(passed);
+}
+
+// Critical sections handed to a CombiningLock or DelegationLock may run on
+// any thread, but never two at once.
+template <typename LockType>
+void test_execute_correctness(const std::string& name, int num_threads, int iterations_per_thread) {
+    LockType lock;
+    Counter counter;
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back([&]() {
+            auto section = [&]() { counter.increment(); };
+            for (int j = 0; j < iterations_per_thread; j++) {
+                lock.execute(section);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    int expected = num_threads * iterations_per_thread;
+    int actual = counter.get();
+
+    std::cout << "Correctness test for " << name << ": "
+              << (expected == actual ? "PASSED" : "FAILED")
+              << " (Expected: " << expected << ", Actual: " << actual << ")"
+              << std::endl;
+
+    assert(expected == actual);
+}
+
+// Every item pushed into a queue is popped exactly once: producers push
+// distinct values, consumers pop until they have seen all of them. The
+// capacity is small, so producers keep finding the queue full.
+template <typename QueueType>
+void test_queue_correctness(const std::string& name, int producers, int consumers, int items_per_producer) {
+    QueueType queue(16);
+    std::atomic<long> popped{0};
+    std::atomic<uint64_t> popped_sum{0};
+    std::vector<std::thread> threads;
+    const long total = static_cast<long>(producers) * items_per_producer;
+
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p]() {
+            for (int i = 0; i < items_per_producer; i++) {
+                while (!queue.try_push(static_cast<uint64_t>(p) * items_per_producer + i + 1)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int c = 0; c < consumers; c++) {
+        threads.emplace_back([&]() {
+            uint64_t value;
+            while (popped.load() < total) {
+                if (queue.try_pop(value)) {
+                    popped_sum += value;
+                    popped++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    uint64_t expected = static_cast<uint64_t>(total) * (total + 1) / 2;
+    bool passed = popped == total && popped_sum == expected;
+    std::cout << "Correctness test for " << name << ": " << (passed ? "PASSED" : "FAILED")
+              << " (Expected sum: " << expected << ", Actual: " << popped_sum << ")" << std::endl;
+
+    assert(passed);
+}
+
+// Every task pushed into a work-stealing deque is taken exactly once,
+// either by the owner popping it or by a thief stealing it. The deque
+// starts small, so it also has to grow while being stolen from.
+template <typename DequeType>
+void test_deque_correctness(const std::string& name, int thieves, int tasks) {
+    DequeType deque(4);
+    std::atomic<bool> pushing{true};
+    std::atomic<long> taken{0};
+    std::atomic<uint64_t> taken_sum{0};
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < thieves; t++) {
+        threads.emplace_back([&]() {
+            uint64_t task;
+            while (pushing.load() || !deque.empty()) {
+                if (deque.steal(task)) {
+                    taken_sum += task;
+                    taken++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    uint64_t task;
+    for (int i = 1; i <= tasks; i++) {
+        deque.push(i);
+        if (i % 3 == 0 && deque.pop(task)) {
+            taken_sum += task;
+            taken++;
+        }
+    }
+    pushing = false;
+    while (deque.pop(task)) {
+        taken_sum += task;
+        taken++;
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    uint64_t expected = static_cast<uint64_t>(tasks) * (tasks + 1) / 2;
+    bool passed = taken == tasks && taken_sum == expected;
+    std::cout << "Correctness test for " << name << ": " << (passed ? "PASSED" : "FAILED")
+              << " (Expected sum: " << expected << ", Actual: " << taken_sum << ")" << std::endl;
+
+    assert(passed);
+}
+
+// Every thread pushes its own values and pops as many, so popped nodes are
+// retired while other threads are still reading the top. Every value must
+// come out exactly once, and the domain's books must balance: one retire
+// per pop, with what has not been freed yet still pending.
+template<typename StackType>
+void test_stack_correctness(const std::string& name, int num_threads, int items_per_thread) {
+    StackType stack;
+    std::atomic<uint64_t> popped_sum{0};
+    std::atomic<long> popped{0};
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t]() {
+            uint64_t value;
+            for (int i = 1; i <= items_per_thread; i++) {
+                stack.push(static_cast<uint64_t>(t) * items_per_thread + i);
+                if (stack.pop(value)) {
+                    popped_sum += value;
+                    popped++;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    uint64_t value;
+    while (stack.pop(value)) {
+        popped_sum += value;
+        popped++;
+    }
+
+    long total = static_cast<long>(num_threads) * items_per_thread;
+    uint64_t expected = static_cast<uint64_t>(total) * (total + 1) / 2;
+    ReclaimStats reclaimed = stack.reclamation();
+    bool books = reclaimed.retired == 0 || (reclaimed.retired == static_cast<uint64_t>(total) &&
+                                            reclaimed.freed + reclaimed.pending() == reclaimed.retired);
+    bool passed = popped == total && popped_sum == expected && books;
+    std::cout << "Correctness test for " << name << ": " << (passed ? "PASSED" : "FAILED")
+              << " (Expected sum: " << expected << ", Actual: " << popped_sum << ", retired " << reclaimed.retired
+              << ", freed " << reclaimed.freed << ", peak pending " << reclaimed.peakPending << ")" << std::endl;
+
+    assert(passed);
+}
+
 // Benchmark
 template<typename LockType>
 double benchmark(LockType& lock, int num_threads, int iterations_per_thread, int critical_section_work) {
@@ -74,13 +467,10 @@ double benchmark(LockType& lock, int num_threads, int iterations_per_thread, int
 
     auto worker = [&](int id) {
         for (int i = 0; i < iterations_per_thread; i++) {
-            if constexpr (std::is_same_v<LockType, MCSLock>) {
-                MCSLock::Node node;
-                lock.lock(node);
+            if constexpr (requires { typename LockType::Node; }) {
+                MCSLockGuard<LockType> guard(lock);
                 counter.increment();
                 for (volatile int j = 0; j < critical_section_work; j++) {}
-                
-                lock.unlock(node);
             } else {
                 lock.lock();
                 
@@ -108,6 +498,87 @@ double benchmark(LockType& lock, int num_threads, int iterations_per_thread, int
     return duration.count();
 }
 
+// Drives AdaptiveLock through both modes: yielding inside the critical
+// section makes every other thread wait, which must switch it to queue
+// mode; a single thread afterwards must bring it back to spin mode.
+void test_adaptive_switching(int num_threads, int iterations_per_thread) {
+    AdaptiveLock lock;
+    int count = 0;
+    std::atomic<bool> queued{false};
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < iterations_per_thread; j++) {
+                lock.lock();
+                count++;
+                if (lock.queueing()) {
+                    queued = true;
+                }
+                std::this_thread::yield();
+                lock.unlock();
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int j = 0; j < 1000; j++) {
+        lock.lock();
+        count++;
+        lock.unlock();
+    }
+
+    int expected = num_threads * iterations_per_thread + 1000;
+    bool passed = count == expected && queued && !lock.queueing();
+    std::cout << "Mode switching test for AdaptiveLock: " << (passed ? "PASSED" : "FAILED")
+              << " (Expected: " << expected << ", Actual: " << count
+              << ", queue mode under contention: " << (queued ? "yes" : "no")
+              << ", spin mode afterwards: " << (lock.queueing() ? "no" : "yes") << ")" << std::endl;
+    assert(passed);
+}
+
+// The profiled wrapper must stay a correct lock and count every
+// acquisition, whichever acquire path is used, and every failed try.
+template<typename LockType>
+void test_profiled_correctness(int num_threads, int iterations_per_thread) {
+    ProfiledLock<LockType> lock("profiled");
+    test_correctness(lock, num_threads, iterations_per_thread);
+
+    int guarded = 0;
+    if constexpr (requires { typename LockType::Node; }) {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_threads; i++) {
+            threads.emplace_back([&]() {
+                for (int j = 0; j < iterations_per_thread; j++) {
+                    MCSLockGuard<ProfiledLock<LockType>> guard(lock);
+                    guarded++;
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        assert(guarded == num_threads * iterations_per_thread);
+    }
+
+    // one more acquisition, and a try from another thread that must fail
+    bool refused = false;
+    lock.lock();
+    std::thread([&]() { refused = !lock.try_lock(); }).join();
+    lock.unlock();
+
+    LockProfile profile = lock.snapshot();
+    uint64_t expected = uint64_t(num_threads) * iterations_per_thread + guarded + 1;
+    bool passed = refused && profile.acquisitions == expected && profile.contended <= expected &&
+                  profile.failedTries == 1;
+    std::cout << "Profile counts for " << typeid(LockType).name() << ": "
+              << (passed ? "PASSED" : "FAILED") << "\n    ";
+    lock.dump(std::cout);
+    assert(passed);
+}
+
 int main() {
     const int NUM_THREADS[] = {1, 2, 4, 8, 16};
     const int ITERATIONS_PER_THREAD = 100000;
@@ -130,11 +601,112 @@ int main() {
         test_correctness(ttas_lock, 4, 10000);
     }
     
+    {
+        TicketLock ticket_lock;
+        test_correctness(ticket_lock, 4, 10000);
+    }
+    
     {
         MCSLock mcs_lock;
         test_correctness(mcs_lock, 4, 10000);
     }
     
+    {
+        ParkingMCSLock parking_mcs_lock;
+        test_correctness(parking_mcs_lock, 8, 10000);
+    }
+    
+    {
+        CLHLock clh_lock;
+        test_correctness(clh_lock, 4, 10000);
+    }
+    
+    {
+        CohortLock<> cohort_lock;
+        test_correctness(cohort_lock, 4, 10000);
+    }
+    
+    {
+        AdaptiveLock adaptive_lock;
+        test_correctness(adaptive_lock, 8, 10000);
+    }
+    
+    {
+        // low thresholds, so the lock keeps switching modes under the test
+        BasicAdaptiveLock<40, 8> switching_lock;
+        test_correctness(switching_lock, 8, 10000);
+    }
+    
+    test_adaptive_switching(4, 2000);
+
+    test_nested_correctness<MCSLock>("MCSLock", 4, 10000);
+    test_nested_correctness<ParkingMCSLock>("ParkingMCSLock", 4, 10000);
+    test_nested_correctness<CohortLock<>>("CohortLock", 4, 10000);
+    test_nested_correctness<CLHLock>("CLHLock", 4, 10000);
+
+    {
+        AbortableCLHLock abortable_lock;
+        test_correctness(abortable_lock, 4, 10000);
+    }
+
+    test_try_lock_correctness<TASLock>("TASLock", 4, 2000);
+    test_try_lock_correctness<TTASLockWithBackoff>("TTASLockWithBackoff", 4, 2000);
+    test_try_lock_correctness<TicketLock>("TicketLock", 4, 2000);
+    test_try_lock_correctness<MCSLock>("MCSLock", 4, 2000);
+    test_try_lock_correctness<ParkingMCSLock>("ParkingMCSLock", 4, 2000);
+    test_try_lock_correctness<CLHLock>("CLHLock", 4, 2000);
+    test_try_lock_correctness<AbortableCLHLock>("AbortableCLHLock", 8, 2000);
+    test_try_lock_correctness<CohortLock<>>("CohortLock", 4, 2000);
+    test_try_lock_correctness<AdaptiveLock>("AdaptiveLock", 4, 2000);
+    test_try_lock_correctness<ElidedLock<TTASLock>>("ElidedLock", 4, 2000);
+    test_try_lock_correctness<PhaseFairRWLock>("PhaseFairRWLock", 4, 2000);
+    test_try_lock_correctness<BigReaderLock<>>("BigReaderLock", 4, 2000);
+    test_try_lock_correctness<ProfiledLock<TicketLock>>("ProfiledLock<TicketLock>", 4, 2000);
+    
+    {
+        // every acquisition either commits or runs under the fallback lock
+        ElidedLock<TTASLock> elided_lock;
+        test_correctness(elided_lock, 8, 10000);
+        ElisionStats s = elided_lock.stats();
+        bool accounted = s.commits + s.fallbacks == 8 * 10000;
+        std::cout << "Elision accounting for ElidedLock: " << (accounted ? "PASSED" : "FAILED")
+                  << " (" << s << ")" << std::endl;
+    }
+    
+    {
+        ElidedLock<MCSLock, 1> elided_mcs_lock;
+        test_correctness(elided_mcs_lock, 4, 10000);
+    }
+    
+    {
+        PhaseFairRWLock phase_fair_lock;
+        test_rw_correctness(phase_fair_lock, 4, 2, 10000);
+    }
+    
+    {
+        BigReaderLock<> big_reader_lock;
+        test_rw_correctness(big_reader_lock, 4, 2, 10000);
+    }
+    
+    test_execute_correctness<CombiningLock>("CombiningLock", 8, 10000);
+    test_execute_correctness<DelegationLock>("DelegationLock", 8, 10000);
+    
+    test_queue_correctness<BoundedMPMCQueue<uint64_t>>("BoundedMPMCQueue", 4, 4, 10000);
+    test_queue_correctness<LockedQueue<uint64_t, MCSLock>>("LockedQueue<MCSLock>", 4, 4, 10000);
+    test_deque_correctness<WorkStealingDeque<uint64_t>>("WorkStealingDeque", 3, 100000);
+    test_deque_correctness<LockedDeque<uint64_t, TTASLock>>("LockedDeque<TTASLock>", 3, 100000);
+    test_stack_correctness<LockFreeStack<uint64_t, EpochDomain>>("LockFreeStack<EpochDomain>", 4, 50000);
+    test_stack_correctness<LockFreeStack<uint64_t, HazardDomain>>("LockFreeStack<HazardDomain>", 4, 50000);
+    test_stack_correctness<LockedStack<uint64_t, TTASLock>>("LockedStack<TTASLock>", 4, 50000);
+    
+    test_profiled_correctness<SpinLock<TestAndSet, CountingBackoff<>>>(4, 10000);
+    test_profiled_correctness<MCSLock>(4, 10000);
+    
+    {
+        ProfiledLock<TicketLock, false> unprofiled_lock;
+        test_correctness(unprofiled_lock, 4, 10000);
+    }
+    
     // Performance benchmarks
     std::cout << "\nPerformance Benchmarks (milliseconds):" << std::endl;
     std::cout << "------------------------------------" << std::endl;
@@ -5,84 +5,65 @@
 #include <mutex>
 #include <iomanip>
 #include <atomic>
+#include <shared_mutex>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
 #include "lock.h"
+#include "../sync/rwlock.h"
+#include "../sync/elision.h"
+#include "../sync/delegation.h"
+#include "../bench/harness.h"
 
 // For the benchmark
 const int DEFAULT_ITERATIONS = 1000000;
-const int MAX_DELAY = 1024; // for backoff
-const int INITIAL_DELAY = 1;
 
 // Counter
 volatile int counter = 0;
 int iterations = DEFAULT_ITERATIONS;
 
-// TASLock with backoff
-class TASLockWithBackoff {
-private:
-    std::atomic<bool> locked{false};
+// How every benchmark is measured: --warmup and --trials set the trial
+// counts, --latency records per-acquire wait and hold times, --perf counts
+// hardware events on every benchmark thread
+TrialOptions measurement;
 
-public:
-    void acquire() {
-        unsigned delay = INITIAL_DELAY;
-        while (locked.exchange(true, std::memory_order_acquire)) {
-            // Wait a bit before trying again
-            std::this_thread::sleep_for(std::chrono::nanoseconds(delay));
-            if (delay < MAX_DELAY) {
-                delay *= 2;
-            }
-        }
-    }
-
-    void release() {
-        locked.store(false, std::memory_order_release);
-    }
-};
-
-// TTASLock with backoff
-class TTASLockWithBackoff {
-private:
-    std::atomic<bool> locked{false};
-
-public:
-    void acquire() {
-        unsigned delay = INITIAL_DELAY;
-        while (true) {
-            while (locked.load(std::memory_order_relaxed)) {
-                // Wait
-            }
-            
-            if (!locked.exchange(true, std::memory_order_acquire)) {
-                return;
-            }
-            
-            // Wait a bit before trying again
-            std::this_thread::sleep_for(std::chrono::nanoseconds(delay));
-            if (delay < MAX_DELAY) {
-                delay *= 2;
-            }
-        }
-    }
+// Set by --placement: where benchmark threads are pinned
+Placement placement = Placement::None;
 
-    void release() {
-        locked.store(false, std::memory_order_release);
-    }
-};
+// CPUs for a run: the caller's explicit list, else the placement policy's.
+std::vector<int> worker_cpus(int numThreads, const std::vector<int>& cpus = {}) {
+    return cpus.empty() ? placement_cpus(placement, numThreads) : cpus;
+}
 
-// Worker thread function
+// Read-mostly worker: readPercent of the operations read counter under a
+// shared lock, the rest increment it under an exclusive one. Exclusive-only
+// locks take every operation exclusively. Returns the number of writes.
 template <typename Lock>
-void test_lock(Lock& lock, int iterations) {
+int test_rw_lock(Lock& lock, int iterations, int readPercent, uint32_t seed) {
+    uint32_t state = seed * 2654435761u | 1;
+    int writes = 0;
+    int sink = 0;
     for (int i = 0; i < iterations; i++) {
-        lock.acquire();
-        counter++;
-        lock.release();
-    }
-}
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
 
-void test_std_mutex(std::mutex& mtx, int iterations) {
-    for (int i = 0; i < iterations; i++) {
-        std::lock_guard<std::mutex> guard(mtx);
-        counter++;
+        if (static_cast<int>(state % 100) < readPercent) {
+            if constexpr (SharedLockable<Lock>) {
+                std::shared_lock<Lock> guard(lock);
+                sink += counter;
+            } else {
+                std::lock_guard<Lock> guard(lock);
+                sink += counter;
+            }
+        } else {
+            std::lock_guard<Lock> guard(lock);
+            counter++;
+            writes++;
+        }
     }
+    (void)sink;
+    return writes;
 }
 
 // Result structure
@@ -92,15 +73,79 @@ struct BenchmarkResult {
     int totalOperations;
     double executionTime;
     double operationsPerSecond;
-    
+    double spread = 0;          // relative stddev of throughput over the trials
+    std::string cpus = "unpinned";
+
+    // Only when the run recorded them
+    bool hasLatency = false;
+    double fairness = 1.0;
+    LatencySummary wait;
+    LatencySummary hold;
+    bool hasPerf = false;
+    PerfSample perf;
+    long perfOperations = 0;    // operations perf counted over, every trial
+
+    // Time and throughput of the median trial.
+    static BenchmarkResult of(const std::string& lockName, const RunResult& run) {
+        BenchmarkResult result;
+        result.lockName = lockName;
+        result.numThreads = run.threads;
+        result.totalOperations = run.operations;
+        result.executionTime = run.seconds;
+        result.operationsPerSecond = run.ops_per_second();
+        result.spread = run.relative_stddev();
+        result.cpus = describe_cpus(run.cpus);
+        if (run.hasLatency) {
+            ThreadLatency merged = merge_latency(run.latency);
+            result.hasLatency = true;
+            result.fairness = jain_fairness(run.latency);
+            result.wait = LatencySummary::of(merged.wait);
+            result.hold = LatencySummary::of(merged.hold);
+        }
+        result.hasPerf = run.hasPerf;
+        result.perf = run.perf;
+        result.perfOperations = run.measuredOperations;
+        return result;
+    }
+
+    static std::string percent(double fraction) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << 100 * fraction << "%";
+        return out.str();
+    }
+
+    static std::string percentiles(const LatencySummary& s) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(0)
+            << s.p50 << "/" << s.p99 << "/" << s.p999 << "/" << s.max;
+        return out.str();
+    }
+
     static void printHeader() {
         std::cout << std::left << std::setw(25) << "Lock Type" 
                   << std::setw(15) << "Threads" 
                   << std::setw(15) << "Operations" 
                   << std::setw(15) << "Time (s)" 
-                  << std::setw(20) << "Ops/second" 
-                  << std::endl;
-        std::cout << std::string(90, '-') << std::endl;
+                  << std::setw(10) << "Stddev" 
+                  << std::setw(20) << "Ops/second";
+        if (measurement.latency) {
+            std::cout << std::setw(10) << "Fairness"
+                      << std::setw(32) << "Wait p50/p99/p99.9/max (ns)"
+                      << std::setw(32) << "Hold p50/p99/p99.9/max (ns)";
+        }
+        if (measurement.perf) {
+            std::cout << std::setw(12) << "Cycles/op"
+                      << std::setw(12) << "Instr/op"
+                      << std::setw(12) << "LLC-miss/op"
+                      << std::setw(12) << "L1D-miss/op"
+                      << std::setw(12) << "Ctx-switch";
+        }
+        std::cout << "CPUs" << std::endl;
+        printSeparator();
+    }
+
+    static void printSeparator() {
+        std::cout << std::string(110 + (measurement.latency ? 74 : 0) + (measurement.perf ? 60 : 0), '-') << std::endl;
     }
     
     void print() const {
@@ -108,123 +153,107 @@ struct BenchmarkResult {
                   << std::setw(15) << numThreads 
                   << std::setw(15) << totalOperations 
                   << std::fixed << std::setprecision(4) << std::setw(15) << executionTime 
-                  << std::fixed << std::setprecision(0) << std::setw(20) << operationsPerSecond 
-                  << std::endl;
+                  << std::setprecision(1) << std::setw(10) << percent(spread)
+                  << std::fixed << std::setprecision(0) << std::setw(20) << operationsPerSecond;
+        if (hasLatency) {
+            std::cout << std::fixed << std::setprecision(3) << std::setw(10) << fairness
+                      << std::setw(32) << percentiles(wait)
+                      << std::setw(32) << percentiles(hold);
+        }
+        if (hasPerf) {
+            // no raw event is asked for here
+            for (int e = 0; e < PERF_RAW; e++) {
+                double value = e == PERF_CONTEXT_SWITCHES ? perf.values[e] : perf.per_op(e, perfOperations);
+                std::cout << std::setw(12);
+                if (perf.valid[e]) {
+                    std::cout << std::fixed << std::setprecision(e == PERF_CONTEXT_SWITCHES ? 0 : 2) << value;
+                } else {
+                    std::cout << "n/a";
+                }
+            }
+        }
+        std::cout << cpus << std::endl;
     }
 };
 
-// Generic benchmark function
+// Lock benchmark: every operation increments a shared count under the
+// lock, through the lock's own interface (queue node, acquire/release or
+// lock/unlock). If cpus is not empty, thread i is pinned to
+// cpus[i % cpus.size()].
 template <typename LockType>
-void benchmark(const std::string& lockName, int numThreads, int iterationsPerThread) {
+void benchmark(const std::string& lockName, int numThreads, int iterationsPerThread,
+               const std::vector<int>& explicitCpus = {}) {
     LockType lock;
-    counter = 0;
-    std::vector<std::thread> threads;
-    
-    int totalOperations = numThreads * iterationsPerThread;
+    ThreadPlan plan{numThreads, worker_cpus(numThreads, explicitCpus), iterationsPerThread};
+    RunResult run = run_lock_trials(lock, plan, measurement);
     
-    auto start = std::chrono::high_resolution_clock::now();
+    BenchmarkResult::of(lockName, run).print();
     
-    // Start threads
-    for (int i = 0; i < numThreads; i++) {
-        threads.emplace_back(test_lock<LockType>, std::ref(lock), iterationsPerThread);
+    // Elided locks: how the critical sections ended
+    if constexpr (requires { lock.eliding(); }) {
+        std::cout << "  elision " << (lock.eliding() ? "(RTM)" : "(no RTM, fallback only)") << ": "
+                  << lock.stats() << std::endl;
     }
     
-    // Join threads
-    for (auto& t : threads) {
-        t.join();
-    }
-    
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> diff = end - start;
-    
-    // Results
-    BenchmarkResult result;
-    result.lockName = lockName;
-    result.numThreads = numThreads;
-    result.totalOperations = totalOperations;
-    result.executionTime = diff.count();
-    result.operationsPerSecond = totalOperations / diff.count();
-    
-    result.print();
-    
-    // Check if it's correct
-    if (counter != totalOperations) {
-        std::cout << "ERROR: Counter is " << counter << " but should be " << totalOperations << std::endl;
+    if (!run.correct) {
+        std::cout << "ERROR: " << lockName << " lost increments" << std::endl;
     }
 }
 
-// For std::mutex
-void benchmark_std_mutex(int numThreads, int iterationsPerThread) {
-    std::mutex mtx;
-    counter = 0;
-    std::vector<std::thread> threads;
-    
-    int totalOperations = numThreads * iterationsPerThread;
-    
-    auto start = std::chrono::high_resolution_clock::now();
-    
-    for (int i = 0; i < numThreads; i++) {
-        threads.emplace_back(test_std_mutex, std::ref(mtx), iterationsPerThread);
-    }
-    
-    for (auto& t : threads) {
-        t.join();
-    }
+// For DelegationLock: every increment runs on the server thread, which is
+// pinned to the CPU after the clients' when the run is pinned. Wait is the
+// whole round trip; the hold time is spent on the server and not recorded.
+void benchmark_delegation(int numThreads, int iterationsPerThread) {
+    ThreadPlan plan{numThreads, worker_cpus(numThreads + 1), iterationsPerThread};
+    int serverCpu = plan.cpus.empty() ? -1 : plan.cpus[numThreads % plan.cpus.size()];
+    DelegationLock lock(numThreads, serverCpu);
+    auto section = []() { counter++; };
     
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> diff = end - start;
-    
-    BenchmarkResult result;
-    result.lockName = "std::mutex";
-    result.numThreads = numThreads;
-    result.totalOperations = totalOperations;
-    result.executionTime = diff.count();
-    result.operationsPerSecond = totalOperations / diff.count();
+    RunResult run = run_trials(
+        plan, measurement, []() { counter = 0; },
+        [&](int, auto more, ThreadLatency* stats) {
+            long done = 0;
+            for (; more(done); done++) {
+                if (stats == nullptr) {
+                    lock.execute(section);
+                    continue;
+                }
+                uint64_t requested = read_ticks();
+                lock.execute(section);
+                stats->wait.record(read_ticks() - requested);
+            }
+            return done;
+        },
+        [](long operations) { return counter == operations; });
     
-    result.print();
+    BenchmarkResult::of("DelegationLock", run).print();
     
-    if (counter != totalOperations) {
-        std::cout << "ERROR: Counter is " << counter << " but should be " << totalOperations << std::endl;
+    if (!run.correct) {
+        std::cout << "ERROR: DelegationLock lost increments" << std::endl;
     }
 }
 
-// For MCSLock
-void benchmark_mcs_lock(int numThreads, int iterationsPerThread) {
-    MCSLock mcsLock;
-    counter = 0;
-    std::vector<std::thread> threads;
-    
-    int totalOperations = numThreads * iterationsPerThread;
-    
-    auto start = std::chrono::high_resolution_clock::now();
-    
-    for (int i = 0; i < numThreads; i++) {
-        threads.emplace_back([&mcsLock, iterationsPerThread]() {
-            for (int j = 0; j < iterationsPerThread; j++) {
-                MCSLockGuard guard(mcsLock);
-                counter++;
-            }
-        });
-    }
-    
-    for (auto& t : threads) {
-        t.join();
-    }
-    
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> diff = end - start;
+// For reader-writer locks; every lock runs the same read/write mix
+template <typename LockType>
+void benchmark_rw(const std::string& lockName, int numThreads, int iterationsPerThread, int readPercent) {
+    LockType lock;
+    std::atomic<int> writes{0};
+    ThreadPlan plan{numThreads, worker_cpus(numThreads), iterationsPerThread};
+    TrialOptions options = measurement;
+    options.latency = false;
     
-    BenchmarkResult result;
-    result.lockName = "MCSLock";
-    result.numThreads = numThreads;
-    result.totalOperations = totalOperations;
-    result.executionTime = diff.count();
-    result.operationsPerSecond = totalOperations / diff.count();
+    RunResult run = run_trials(
+        plan, options, [&]() { counter = 0; writes = 0; },
+        [&](int id, auto, ThreadLatency*) {
+            writes += test_rw_lock(lock, iterationsPerThread, readPercent, id + 1);
+            return static_cast<long>(iterationsPerThread);
+        },
+        [&](long) { return counter == writes; });
     
-    result.print();
+    BenchmarkResult::of(lockName, run).print();
     
-    if (counter != totalOperations) {
-        std::cout << "ERROR: Counter is " << counter << " but should be " << totalOperations << std::endl;
+    if (!run.correct) {
+        std::cout << "ERROR: Counter is " << counter << " but should be " << writes << std::endl;
     }
 }
 
@@ -239,25 +268,134 @@ void run_scalability_test(int maxThreads, int iterationsPerThread) {
         benchmark<TASLockWithBackoff>("TASLock+Backoff", numThreads, iterationsPerThread);
         benchmark<TTASLock>("TTASLock", numThreads, iterationsPerThread);
         benchmark<TTASLockWithBackoff>("TTASLock+Backoff", numThreads, iterationsPerThread);
-        benchmark_mcs_lock(numThreads, iterationsPerThread);
-        benchmark_std_mutex(numThreads, iterationsPerThread);
+        benchmark<TicketLock>("TicketLock", numThreads, iterationsPerThread);
+        benchmark<MCSLock>("MCSLock", numThreads, iterationsPerThread);
+        benchmark<ParkingMCSLock>("MCSLock+Park", numThreads, iterationsPerThread);
+        benchmark<CLHLock>("CLHLock", numThreads, iterationsPerThread);
+        benchmark<CohortLock<>>("CohortLock", numThreads, iterationsPerThread);
+        benchmark<AdaptiveLock>("AdaptiveLock", numThreads, iterationsPerThread);
+        benchmark<ElidedLock<TTASLock>>("TTASLock+Elision", numThreads, iterationsPerThread);
+        benchmark_delegation(numThreads, iterationsPerThread);
+        benchmark<std::mutex>("std::mutex", numThreads, iterationsPerThread);
         
         // Add a separator 
         if (numThreads * 2 <= maxThreads) {
-            std::cout << std::string(90, '-') << std::endl;
+            BenchmarkResult::printSeparator();
+        }
+    }
+}
+
+// More threads than hardware threads: spinning waiters steal the lock
+// holder's core, parking waiters give it back.
+void run_oversubscription_test(int hardwareThreads, int iterationsPerThread) {
+    std::cout << "\n=== Oversubscribed (" << hardwareThreads << " hardware threads), "
+              << iterationsPerThread << " iterations per thread ===" << std::endl;
+    BenchmarkResult::printHeader();
+
+    for (int factor = 2; factor <= 8; factor *= 2) {
+        int numThreads = hardwareThreads * factor;
+        benchmark<TTASLock>("TTASLock", numThreads, iterationsPerThread);
+        benchmark<MCSLock>("MCSLock", numThreads, iterationsPerThread);
+        benchmark<ParkingMCSLock>("MCSLock+Park", numThreads, iterationsPerThread);
+        benchmark<std::mutex>("std::mutex", numThreads, iterationsPerThread);
+
+        if (factor * 2 <= 8) {
+            BenchmarkResult::printSeparator();
         }
     }
 }
 
-int main() {
+// Threads pinned round-robin across NUMA nodes (thread i on node
+// i % nodes), so every plain handoff is as likely as not to cross a socket.
+void run_numa_test(int maxThreads, int iterationsPerThread) {
+    const NumaTopology& topology = NumaTopology::get();
+    std::vector<int> cpus;
+    for (size_t slot = 0; cpus.size() < static_cast<size_t>(maxThreads); slot++) {
+        bool added = false;
+        for (int node = 0; node < topology.node_count(); node++) {
+            const std::vector<int>& nodeCpus = topology.cpus_of_node(node);
+            if (slot < nodeCpus.size()) {
+                cpus.push_back(nodeCpus[slot]);
+                added = true;
+            }
+        }
+        if (!added) {
+            break;
+        }
+    }
+
+    std::cout << "\n=== NUMA: " << topology.node_count() << " node(s), threads pinned by node, "
+              << iterationsPerThread << " iterations per thread ===" << std::endl;
+    BenchmarkResult::printHeader();
+
+    for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+        benchmark<TTASLock>("TTASLock", numThreads, iterationsPerThread, cpus);
+        benchmark<MCSLock>("MCSLock", numThreads, iterationsPerThread, cpus);
+        benchmark<CohortLock<>>("CohortLock", numThreads, iterationsPerThread, cpus);
+
+        if (numThreads * 2 <= maxThreads) {
+            BenchmarkResult::printSeparator();
+        }
+    }
+}
+
+// Read-mostly workloads (90/10 and 99/1 read/write) against std::shared_mutex
+void run_rw_test(int maxThreads, int iterationsPerThread) {
+    for (int readPercent : {90, 99}) {
+        std::cout << "\n=== " << readPercent << "/" << 100 - readPercent << " read/write, "
+                  << iterationsPerThread << " iterations per thread ===" << std::endl;
+        BenchmarkResult::printHeader();
+
+        for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+            benchmark_rw<TTASLock>("TTASLock", numThreads, iterationsPerThread, readPercent);
+            benchmark_rw<PhaseFairRWLock>("PhaseFairRWLock", numThreads, iterationsPerThread, readPercent);
+            benchmark_rw<BigReaderLock<>>("BigReaderLock", numThreads, iterationsPerThread, readPercent);
+            benchmark_rw<std::shared_mutex>("std::shared_mutex", numThreads, iterationsPerThread, readPercent);
+
+            if (numThreads * 2 <= maxThreads) {
+                BenchmarkResult::printSeparator();
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--latency") == 0) {
+            measurement.latency = true;
+        } else if (std::strcmp(argv[i], "--perf") == 0) {
+            measurement.perf = true;
+        } else if (std::strncmp(argv[i], "--warmup=", 9) == 0) {
+            measurement.warmup = std::atoi(argv[i] + 9);
+        } else if (std::strncmp(argv[i], "--trials=", 9) == 0 && std::atoi(argv[i] + 9) > 0) {
+            measurement.trials = std::atoi(argv[i] + 9);
+        } else if (std::strncmp(argv[i], "--placement=", 12) == 0 && parse_placement(argv[i] + 12, placement)) {
+            // parsed
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--latency] [--perf] [--warmup=N] [--trials=N]"
+                      << " [--placement=none|compact|scatter|smt-first|one-per-socket]" << std::endl;
+            return 2;
+        }
+    }
+
     // Get how many cores we have
     const int max_threads = std::thread::hardware_concurrency();
     std::cout << "My system has " << max_threads << " threads" << std::endl;
     std::cout << "Using " << iterations << " iterations per thread" << std::endl;
-    std::cout << "Backoff settings: start=" << INITIAL_DELAY << "ns, max=" << MAX_DELAY << "ns" << std::endl;
+    std::cout << "Trials: " << measurement.warmup << " warmup, median of " << measurement.trials
+              << " (outliers beyond " << measurement.outlierMads << " MADs dropped)" << std::endl;
+    std::cout << "Placement: " << placement_name(placement) << " ("
+              << CpuTopology::get().package_count() << " socket(s), " << CpuTopology::get().all().size()
+              << " usable CPUs)" << std::endl;
+    std::cout << "Backoff settings: pause=" << LockBackoff::min_spins << ".." << LockBackoff::max_spins
+              << " spins, yields=" << LockBackoff::yield_rounds
+              << ", sleep=" << LockBackoff::min_sleep_ns << ".." << LockBackoff::max_sleep_ns << "ns" << std::endl;
     
     // Run tests
     run_scalability_test(max_threads, iterations / max_threads);
+    run_oversubscription_test(max_threads, iterations / (max_threads * 8));
+    run_numa_test(max_threads, iterations / max_threads);
+    run_rw_test(max_threads, iterations / max_threads);
     
     return 0;
 }
@@ -1,19 +1,23 @@
 #include "my_barrier.h"
+#include "../sync/pool.h"
+#include "../sync/parallel.h"
+#include "../bench/workload.h"
 #include <vector>
 #include <iostream>
 
+template <typename BarrierType>
 bool testBarrier(int num_threads, int num_iterations)
 {
   std::vector<std::thread> threads;
   std::atomic<int> shared_counter{0};
   std::atomic<bool> start{false};
-  // std::atomic<bool> test_failed{false}; // No longer needed for intermediate check
-  SenseReversingBarrier barrier(num_threads);
+  std::atomic<bool> test_failed{false};
+  BarrierType barrier(num_threads);
 
   for (int i = 0; i < num_threads; ++i)
   {
     // Pass necessary variables by reference/value correctly
-    threads.emplace_back([&barrier, &shared_counter, num_threads, num_iterations, &start]()
+    threads.emplace_back([&barrier, &shared_counter, num_threads, num_iterations, &start, &test_failed]()
                          { 
             while (!start.load(std::memory_order_acquire)) { // Use acquire load for start flag
                 std::this_thread::yield();
@@ -24,8 +28,12 @@ bool testBarrier(int num_threads, int num_iterations)
 
                 barrier.wait(); 
 
-                // Work after barrier (if any) 
-                // The removed check was here. No intermediate check needed for basic barrier correctness.
+                // Work after barrier: every thread's increment for this phase
+                // must be visible, and nobody can be more than one phase ahead.
+                int seen = shared_counter.load(std::memory_order_relaxed);
+                if (seen < (j + 1) * num_threads || seen > (j + 2) * num_threads) {
+                    test_failed.store(true, std::memory_order_relaxed);
+                }
             } });
   }
 
@@ -36,7 +44,134 @@ bool testBarrier(int num_threads, int num_iterations)
   }
 
   // Final check: Did all expected increments occur?
-  return shared_counter.load() == num_threads * num_iterations;
+  return !test_failed.load() && shared_counter.load() == num_threads * num_iterations;
+}
+
+// The completion step runs once per phase, after every thread's pre-barrier
+// work and before any thread's post-barrier work. Threads use the split
+// arrive()/wait(token) API with work in between.
+bool testCompletionBarrier(int num_threads, int num_iterations)
+{
+  std::vector<std::thread> threads;
+  std::atomic<int> shared_counter{0};
+  std::atomic<bool> test_failed{false};
+  int phases = 0; // written only by the completion step
+
+  auto completion = [&]() noexcept
+  {
+    phases++;
+    if (shared_counter.load(std::memory_order_relaxed) != phases * num_threads)
+    {
+      test_failed.store(true, std::memory_order_relaxed);
+    }
+  };
+  CompletionBarrier<decltype(completion)> barrier(num_threads, completion);
+
+  for (int i = 0; i < num_threads; ++i)
+  {
+    threads.emplace_back([&, num_iterations]()
+                         {
+            for (int j = 0; j < num_iterations; ++j) {
+                shared_counter.fetch_add(1, std::memory_order_relaxed);
+
+                auto token = barrier.arrive();
+                // independent work while the others arrive
+                busy_work(10);
+                barrier.wait(token);
+
+                if (phases != j + 1) {
+                    test_failed.store(true, std::memory_order_relaxed);
+                }
+            } });
+  }
+
+  for (auto &thread : threads)
+  {
+    thread.join();
+  }
+
+  return !test_failed.load() && phases == num_iterations;
+}
+
+// Fork-join on one pool, many times over. Every run gives the workers a
+// fresh barrier for an odd number of phases, so a barrier must not depend
+// on what the same thread did on an earlier one. Then work-stealing tasks:
+// each must run exactly once.
+bool testWorkerPool(int num_threads, int num_runs, int num_tasks)
+{
+  WorkerPool pool(num_threads);
+  std::vector<int> runs(num_threads, 0); // slot i written only by worker i
+  bool failed = false;
+
+  for (int r = 0; r < num_runs; ++r)
+  {
+    std::atomic<int> shared_counter{0};
+    SenseReversingBarrier barrier(num_threads);
+    const int phases = 3;
+    std::atomic<bool> phase_failed{false};
+    pool.run([&](int worker)
+             {
+            runs[worker]++;
+            for (int j = 0; j < phases; ++j) {
+                shared_counter.fetch_add(1, std::memory_order_relaxed);
+                barrier.wait();
+                if (shared_counter.load(std::memory_order_relaxed) < (j + 1) * num_threads) {
+                    phase_failed.store(true, std::memory_order_relaxed);
+                }
+            } });
+    failed = failed || phase_failed.load() || shared_counter.load() != phases * num_threads;
+  }
+  for (int count : runs)
+  {
+    failed = failed || count != num_runs;
+  }
+
+  std::vector<std::atomic<int>> hits(num_tasks);
+  for (int r = 0; r < 3; ++r)
+  {
+    pool.run_tasks(num_tasks, [&](int64_t task)
+                   { hits[task].fetch_add(1, std::memory_order_relaxed); });
+  }
+  for (auto &hit : hits)
+  {
+    failed = failed || hit.load() != 3;
+  }
+
+  return !failed && pool.run_timed([](int) {}) >= 0;
+}
+
+// Every schedule must visit each index exactly once and reduce to the
+// serial sum, including with a worker count that leaves the combine tree
+// unbalanced and a range too short to give every worker a chunk.
+bool testParallelLoops(int num_threads)
+{
+  WorkerPool pool(num_threads);
+  bool failed = false;
+
+  for (Schedule schedule : {Schedule::Static, Schedule::Dynamic, Schedule::Guided})
+  {
+    for (int64_t grain : {0, 1, 7})
+    {
+      for (IndexRange range : {IndexRange{3, 100003}, IndexRange{0, 2}, IndexRange{5, 5}})
+      {
+        std::vector<std::atomic<int>> hits(range.end);
+        parallel_for(pool, range, grain, [&](int64_t i)
+                     { hits[i].fetch_add(1, std::memory_order_relaxed); }, schedule);
+        for (int64_t i = 0; i < range.end; ++i)
+        {
+          failed = failed || hits[i].load() != (i >= range.begin ? 1 : 0);
+        }
+
+        int64_t sum = parallel_reduce(
+            pool, range, grain, int64_t{0}, [](int64_t i)
+            { return i; }, [](int64_t a, int64_t b)
+            { return a + b; }, schedule);
+        failed = failed || sum != (range.begin + range.end - 1) * range.size() / 2;
+      }
+    }
+  }
+
+  return !failed;
 }
 
 int main()
@@ -48,7 +183,39 @@ int main()
   std::cout << "Testing Sense-Reversing Barrier implementation...\n";
   std::cout << "Number of threads: " << num_threads << "\n";
   std::cout << "Number of iterations: " << num_iterations << "\n";
-  std::cout << "Test result: " << (testBarrier(num_threads, num_iterations) ? "PASSED" : "FAILED") << "\n\n";
+  std::cout << "Test result: " << (testBarrier<SenseReversingBarrier>(num_threads, num_iterations) ? "PASSED" : "FAILED") << "\n\n";
+
+  std::cout << "Testing parking Sense-Reversing Barrier implementation...\n";
+  std::cout << "Test result: " << (testBarrier<ParkingSenseReversingBarrier>(num_threads, num_iterations) ? "PASSED" : "FAILED") << "\n\n";
+
+  // Only acquire/release orders the counter reads after the barrier here;
+  // weakly ordered machines (ARM) catch a missing edge that x86 hides.
+  std::cout << "Testing relaxed-ordering Sense-Reversing Barrier implementation...\n";
+  std::cout << "Test result: " << (testBarrier<RelaxedSenseReversingBarrier>(num_threads, num_iterations / 10) ? "PASSED" : "FAILED") << "\n\n";
+
+  std::cout << "Testing completion step and split arrive/wait...\n";
+  std::cout << "Test result: " << (testCompletionBarrier(num_threads, num_iterations / 10) ? "PASSED" : "FAILED") << "\n\n";
+
+  // The tree barriers are checked at an odd width too, where some
+  // threads get byes or wrap around.
+  const int tree_iterations = num_iterations / 10;
+  for (int threads : {num_threads, num_threads + 1})
+  {
+    std::cout << "Testing Tournament Barrier implementation with " << threads << " threads, " << tree_iterations << " iterations...\n";
+    std::cout << "Test result: " << (testBarrier<TournamentBarrier>(threads, tree_iterations) ? "PASSED" : "FAILED") << "\n\n";
+
+    std::cout << "Testing Dissemination Barrier implementation with " << threads << " threads, " << tree_iterations << " iterations...\n";
+    std::cout << "Test result: " << (testBarrier<DisseminationBarrier>(threads, tree_iterations) ? "PASSED" : "FAILED") << "\n\n";
+  }
+
+  std::cout << "Testing worker pool fork-join and work-stealing tasks...\n";
+  std::cout << "Test result: " << (testWorkerPool(num_threads, 10000, 10000) ? "PASSED" : "FAILED") << "\n\n";
+
+  for (int threads : {num_threads, num_threads + 1})
+  {
+    std::cout << "Testing parallel_for and parallel_reduce with " << threads << " workers...\n";
+    std::cout << "Test result: " << (testParallelLoops(threads) ? "PASSED" : "FAILED") << "\n\n";
+  }
 
   return 0;
 }
\ No newline at end of file
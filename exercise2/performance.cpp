@@ -3,49 +3,90 @@
 #include <vector>
 #include <chrono>
 #include <iostream>
+#include <iomanip>
 #include <algorithm>
 #include <barrier>
+#include <string>
+#include <cstring>
 #include "my_barrier.h"
+#include "../sync/topology.h"
+#include "../bench/perf_counters.h"
+#include "../bench/harness.h"
+#include "../bench/workload.h"
+#include "../sync/parallel.h"
+#include "../sync/counter.h"
+
+// Set by --perf: count hardware events on every benchmark thread
+bool measure_perf = false;
+
+// Counters of the last benchmark run, summed over its threads, and how
+// many wait() calls they cover
+PerfSample last_perf;
+double last_waits = 0;
+
+// Set by --placement: where benchmark threads are pinned
+Placement placement = Placement::None;
+
+void record_perf(const std::vector<PerfSample> &perf, int num_threads, int num_iterations)
+{
+  last_perf = merge_perf(perf);
+  last_waits = static_cast<double>(num_threads) * num_iterations;
+}
+
+// With --perf, the last run's counters per wait(), to append to its line
+std::string perf_columns()
+{
+  return measure_perf ? "  [" + format_perf(last_perf, last_waits) + "]" : "";
+}
+
+// The pooled, pinned threads a benchmark runs on under the placement
+// policy; run_timed() on it times only the barrier loop.
+WorkerPool &pool_for(int num_threads)
+{
+  return benchmark_pool(num_threads, placement_cpus(placement, num_threads));
+}
+
 // Benchmark function for our barrier
+template <typename BarrierType = SenseReversingBarrier>
 double benchmarkMyBarrier(int num_threads, int num_iterations)
 {
-  std::vector<std::thread> threads;
-  std::atomic<bool> start{false};
-  SenseReversingBarrier barrier(num_threads);
+  BarrierType barrier(num_threads);
+  std::vector<PerfSample> perf(num_threads);
 
-  auto start_time = std::chrono::high_resolution_clock::now();
-
-  // Create threads
-  for (int i = 0; i < num_threads; ++i)
-  {
-    threads.emplace_back([&barrier, num_iterations, &start]()
-                         {
-            while (!start) {
-                std::this_thread::yield();
-            }
+  double seconds = pool_for(num_threads).run_timed([&](int i)
+                                                   {
+            PerfScope counters(measure_perf ? &perf[i] : nullptr);
             for (int j = 0; j < num_iterations; ++j) {
                 barrier.wait();
             } });
-  }
+  record_perf(perf, num_threads, num_iterations);
 
-  start = true;
-  for (auto &thread : threads)
-  {
-    thread.join();
-  }
+  return seconds;
+}
 
-  auto end_time = std::chrono::high_resolution_clock::now();
-  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+// Each phase does `work` units of independent work. Blocking: work, then
+// wait(). Split: arrive(), work, wait(token), so the work overlaps the
+// time spent waiting for stragglers.
+double benchmarkOverlap(int num_threads, int num_iterations, int work, bool split)
+{
+  SenseReversingBarrier barrier(num_threads);
 
-  return duration.count() / 1000000.0; // Convert to seconds
+  return pool_for(num_threads).run_timed([&](int)
+                                         {
+            for (int j = 0; j < num_iterations; ++j) {
+                if (split) {
+                    auto token = barrier.arrive();
+                    busy_work(work);
+                    barrier.wait(token);
+                } else {
+                    busy_work(work);
+                    barrier.wait();
+                }
+            } });
 }
 
 double benchmarkStdBarrier(int num_threads, int num_iterations)
 {
-
-  std::vector<std::thread> threads;
-  std::atomic<bool> start{false};
-
   // --- Create the std::barrier ---
   // Initialize std::barrier with the number of threads that will participate.
   // The default completion function (std::noop_completion) is implicitly used.
@@ -58,20 +99,12 @@ double benchmarkStdBarrier(int num_threads, int num_iterations)
       return -2.0; // Indicate invalid argument
     }
     std::barrier sync_point{num_threads};
+    std::vector<PerfSample> perf(num_threads);
 
-    // --- Start Timing ---
-    auto start_time = std::chrono::high_resolution_clock::now();
-
-    // --- Create Threads ---
-    for (int i = 0; i < num_threads; ++i)
-    {
-      // Capture the barrier object by reference [&sync_point]
-      threads.emplace_back([&sync_point, num_iterations, &start]()
-                           {
-                // Wait for the start signal (using acquire for visibility)
-                while (!start.load(std::memory_order_acquire)) {
-                    std::this_thread::yield(); // Yield CPU to avoid busy-waiting too hard
-                }
+    // --- Timed on the pool: threads are already running and released together ---
+    double seconds = pool_for(num_threads).run_timed([&](int i)
+                                                     {
+                PerfScope counters(measure_perf ? &perf[i] : nullptr);
 
                 // --- Barrier Synchronization Loop ---
                 for (int j = 0; j < num_iterations; ++j) {
@@ -79,22 +112,9 @@ double benchmarkStdBarrier(int num_threads, int num_iterations)
                     // This is the core operation being benchmarked.
                     sync_point.arrive_and_wait();
                 } });
-    }
-
-    // --- Signal Threads to Start ---
-    // Use release semantics to ensure writes are visible to the acquire loads.
-    start.store(true, std::memory_order_release);
-
-    for (auto &thread : threads)
-    {
-      thread.join();
-    }
-
-    // --- Stop Timing ---
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    record_perf(perf, num_threads, num_iterations);
 
-    return duration.count() / 1000000.0;
+    return seconds;
   }
   catch (const std::exception &e)
   {
@@ -103,8 +123,95 @@ double benchmarkStdBarrier(int num_threads, int num_iterations)
   }
 }
 
-int main()
+template <typename F>
+double seconds_of(F &&f)
 {
+  auto start_time = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+// One loop serially and under each schedule on the pool, as
+// "serial  static (speedup)  dynamic (speedup)  guided (speedup)".
+// cost(i) is the busy_work() units of iteration i.
+template <typename Cost>
+void benchmarkParallelFor(const char *name, WorkerPool &pool, int64_t n, Cost cost)
+{
+  double serial = seconds_of([&]()
+                             {
+    for (int64_t i = 0; i < n; i++)
+    {
+      busy_work(cost(i));
+    } });
+  std::cout << name << "  " << serial;
+  for (Schedule schedule : {Schedule::Static, Schedule::Dynamic, Schedule::Guided})
+  {
+    double seconds = seconds_of([&]()
+                                { parallel_for(pool, {0, n}, 0, [&](int64_t i)
+                                               { busy_work(cost(i)); }, schedule); });
+    std::cout << "  " << seconds << " (" << std::setprecision(2) << serial / seconds << "x)" << std::setprecision(6);
+  }
+  std::cout << "\n";
+}
+
+// Counting the multiples of 3 below n: serially, with parallel_reduce's
+// padded partials and tree combine, and with every worker incrementing one
+// shared FetchAddCounter.
+void benchmarkParallelReduce(WorkerPool &pool, int64_t n)
+{
+  auto hit = [](int64_t i)
+  { return i % 3 == 0 ? int64_t{1} : int64_t{0}; };
+  int64_t serial_count = 0;
+  double serial = seconds_of([&]()
+                             {
+    for (int64_t i = 0; i < n; i++)
+    {
+      serial_count += hit(i);
+    } });
+
+  int64_t reduced = 0;
+  double reduce = seconds_of([&]()
+                             { reduced = parallel_reduce(
+                                   pool, {0, n}, 0, int64_t{0}, hit, [](int64_t a, int64_t b)
+                                   { return a + b; }); });
+
+  FetchAddCounter counter;
+  double contended = seconds_of([&]()
+                                { parallel_for(pool, {0, n}, 0, [&](int64_t i)
+                                               {
+                                      if (hit(i)) {
+                                          counter.increment();
+                                      } }); });
+
+  bool correct = reduced == serial_count && counter.get() == serial_count;
+  std::cout << "count  " << serial << "  " << reduce << " (" << std::setprecision(2) << serial / reduce << "x)  "
+            << contended << " (" << serial / contended << "x)" << std::setprecision(6)
+            << (correct ? "" : "  WRONG COUNT") << "\n";
+}
+
+int main(int argc, char **argv)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    if (std::strcmp(argv[i], "--perf") == 0)
+    {
+      measure_perf = true;
+    }
+    else if (std::strncmp(argv[i], "--placement=", 12) == 0 && parse_placement(argv[i] + 12, placement))
+    {
+      // parsed
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [--perf] [--placement=none|compact|scatter|smt-first|one-per-socket]"
+                << std::endl;
+      return 2;
+    }
+  }
+  std::cout << "Placement: " << placement_name(placement) << ", CPUs in thread order: "
+            << describe_cpus(placement_cpus(placement, CpuTopology::get().all().size())) << "\n";
+
+
   const int num_threads = 10;
   const int num_iterations = 1000000;
 
@@ -112,8 +219,61 @@ int main()
   std::cout << "Number of threads: " << num_threads << std::endl;
   std::cout << "Number of iterations: " << num_iterations << std::endl;
   std::cout << "Benchmarking barrier implementation...\n";
-  std::cout << "Sense-Reversing Barrier time: " << benchmarkMyBarrier(num_threads, num_iterations) << " seconds\n";
-  std::cout << "Standard Barrier time: " << benchmarkStdBarrier(num_threads, num_iterations) << " seconds\n";
+  std::cout << "Sense-Reversing Barrier time: " << benchmarkMyBarrier(num_threads, num_iterations) << " seconds" << perf_columns() << "\n";
+  std::cout << "Relaxed Sense-Reversing Barrier time: " << benchmarkMyBarrier<RelaxedSenseReversingBarrier>(num_threads, num_iterations) << " seconds" << perf_columns() << "\n";
+  std::cout << "Parking Sense-Reversing Barrier time: " << benchmarkMyBarrier<ParkingSenseReversingBarrier>(num_threads, num_iterations) << " seconds" << perf_columns() << "\n";
+  std::cout << "Standard Barrier time: " << benchmarkStdBarrier(num_threads, num_iterations) << " seconds" << perf_columns() << "\n";
+
+  // Oversubscribed: more threads than hardware threads
+  const int oversubscribed_threads = std::max(1u, std::thread::hardware_concurrency()) * 4;
+  const int oversubscribed_iterations = num_iterations / 10;
+  std::cout << "\nOversubscribed, number of threads: " << oversubscribed_threads << std::endl;
+  std::cout << "Number of iterations: " << oversubscribed_iterations << std::endl;
+  std::cout << "Sense-Reversing Barrier time: " << benchmarkMyBarrier(oversubscribed_threads, oversubscribed_iterations) << " seconds" << perf_columns() << "\n";
+  std::cout << "Parking Sense-Reversing Barrier time: " << benchmarkMyBarrier<ParkingSenseReversingBarrier>(oversubscribed_threads, oversubscribed_iterations) << " seconds" << perf_columns() << "\n";
+  std::cout << "Standard Barrier time: " << benchmarkStdBarrier(oversubscribed_threads, oversubscribed_iterations) << " seconds" << perf_columns() << "\n";
+
+  // Overlapping independent work with the barrier
+  const int overlap_iterations = num_iterations / 10;
+  const int overlap_work = 1000;
+  std::cout << "\nOverlap, " << overlap_iterations << " iterations with " << overlap_work << " units of work each\n";
+  std::cout << "Work then wait(): " << benchmarkOverlap(num_threads, overlap_iterations, overlap_work, false) << " seconds\n";
+  std::cout << "arrive(), work, wait(token): " << benchmarkOverlap(num_threads, overlap_iterations, overlap_work, true) << " seconds\n";
+
+  // Sweep thread counts (powers of two, plus the full machine width)
+  const int max_threads = std::max(1u, std::thread::hardware_concurrency());
+  const int sweep_iterations = num_iterations / 10;
+  std::vector<int> sweep;
+  for (int threads = 1; threads < max_threads; threads *= 2)
+  {
+    sweep.push_back(threads);
+  }
+  sweep.push_back(max_threads);
+
+  std::cout << "\nSweep up to " << max_threads << " threads, " << sweep_iterations << " iterations (seconds)\n";
+  std::cout << "Threads  Sense-Reversing  Tournament  Dissemination  std::barrier\n";
+  for (int threads : sweep)
+  {
+    std::cout << threads
+              << "  " << benchmarkMyBarrier(threads, sweep_iterations)
+              << "  " << benchmarkMyBarrier<TournamentBarrier>(threads, sweep_iterations)
+              << "  " << benchmarkMyBarrier<DisseminationBarrier>(threads, sweep_iterations)
+              << "  " << benchmarkStdBarrier(threads, sweep_iterations) << "\n";
+  }
+
+  // Parallel loops against the serial loop. The triangular loop's
+  // iterations grow with i, so static blocks leave the last worker with
+  // most of the work; dynamic and guided rebalance it.
+  const int64_t loop_size = 200000;
+  WorkerPool &loop_pool = pool_for(max_threads);
+  std::cout << "\nParallel loops on " << max_threads << " threads, " << loop_size << " iterations (seconds, speedup over serial)\n";
+  std::cout << "Loop  Serial  Static  Dynamic  Guided\n";
+  benchmarkParallelFor("uniform", loop_pool, loop_size, [](int64_t)
+                       { return int64_t{100}; });
+  benchmarkParallelFor("triangular", loop_pool, loop_size, [&](int64_t i)
+                       { return 200 * i / loop_size; });
+  std::cout << "Reduce  Serial  parallel_reduce  FetchAddCounter\n";
+  benchmarkParallelReduce(loop_pool, 100 * loop_size);
 
   return 0;
 }
\ No newline at end of file
@@ -4,189 +4,244 @@
 #include <vector>
 #include <chrono>
 #include <iostream>
+#include <iomanip>
+#include <sstream>
 #include <random>
+#include <optional>
+#include <memory>
 #include <algorithm>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include "../sync/counter.h"
+#include "../sync/stack.h"
+#include "../sync/lock.h"
+#include "../sync/topology.h"
+#include "../bench/harness.h"
 
 using namespace std;
 
-// Base counter interface
-class Counter
-{
-public:
-  virtual void increment() = 0;
-  virtual int64_t get() const = 0;
-  virtual ~Counter() {}
-};
-
-// Mutex-based counter
-class MutexCounter : public Counter
-{
-private:
-  int64_t value;
-  mutable std::mutex mtx;
+// How every benchmark is measured: --warmup and --trials set the trial
+// counts, --perf counts hardware events on every benchmark thread
+TrialOptions measurement;
 
-public:
-  MutexCounter() : value(0) {}
-
-  void increment()
-  {
-    // lock_guard is = mutex.lock() and mutex.unlock() when it goes out of scope
-    // std::lock_guard<std::mutex> lock(mtx);
-    mtx.lock();
-    value++;
-    mtx.unlock();
-  }
+// Set by --placement: where benchmark threads are pinned
+Placement placement = Placement::None;
 
-  int64_t get() const
-  {
-    std::lock_guard<std::mutex> lock(mtx);
-    return value;
-  }
-};
+ThreadPlan plan_for(int num_threads, int operations_per_thread)
+{
+  return {num_threads, placement_cpus(placement, num_threads), operations_per_thread};
+}
 
-// CAS-based counter with exponential backoff
-class CompareSwapCounter : public Counter
+// Test function to verify counter correctness: one run on a fresh counter,
+// through the concrete type so the calls are devirtualized, as they are in
+// callers.
+template <typename CounterType>
+bool testCounter(int num_threads, int operations_per_thread)
 {
-private:
-  std::atomic<int64_t> value{0};
+  TrialOptions once;
+  once.warmup = 0;
+  once.trials = 1;
+  return run_counter_trials<CounterType>(plan_for(num_threads, operations_per_thread), once).correct;
+}
 
-  void backoff(int &delay)
-  {
-    std::this_thread::sleep_for(std::chrono::microseconds(delay));
-    delay = std::min(delay * 2, 1000); // Cap at 1ms
-  }
+// Benchmark function: warmup and timed trials, each on a fresh counter
+template <typename CounterType>
+RunResult benchmarkCounter(int num_threads, int operations_per_thread)
+{
+  return run_counter_trials<CounterType>(plan_for(num_threads, operations_per_thread), measurement);
+}
 
-public:
-  void increment() override
-  {
-    int delay = 1;
-    while (true)
-    {
-      int64_t current = value.load();
-      if (value.compare_exchange_strong(current, current + 1))
+// False sharing: every thread increments a FetchAddCounter of its own,
+// from an array laid out with Padding. Nothing is logically shared, so the
+// packed array's loss against the padded ones is all false sharing.
+template <typename Padding>
+RunResult benchmarkCounterArray(int num_threads, int operations_per_thread)
+{
+  std::vector<Padded<FetchAddCounter, Padding>> counters;
+  return run_trials(
+      plan_for(num_threads, operations_per_thread), measurement,
+      [&]()
+      { counters = std::vector<Padded<FetchAddCounter, Padding>>(num_threads); },
+      [&](int id, auto more, ThreadLatency *)
       {
-        break;
-      }
-      backoff(delay);
-    }
-  }
+        FetchAddCounter &mine = counters[id].value;
+        long done = 0;
+        for (; more(done); done++)
+        {
+          mine.increment();
+        }
+        return done;
+      },
+      [&](long operations)
+      {
+        int64_t total = 0;
+        for (int i = 0; i < num_threads; i++)
+        {
+          total += counters[i].value.get();
+        }
+        return total == operations;
+      });
+}
 
-  int64_t get() const override
-  {
-    return value.load();
-  }
-};
+// Depth the stack benchmark keeps below the pushes and pops
+const int stack_depth = 1024;
 
-// Fetch-and-add based counter
-class FetchAddCounter : public Counter
+// Stack benchmark: every operation is a push followed by a pop, on a fresh
+// stack holding stack_depth nodes. peak_bytes is the most node memory
+// live at once over the trials: the stack itself plus, for the lock-free
+// stacks, the popped nodes their domain had not freed yet.
+template <typename StackType>
+RunResult benchmarkStack(int num_threads, int operations_per_thread, uint64_t &peak_bytes)
 {
-private:
-  std::atomic<int64_t> value{0};
-
-public:
-  void increment() override
-  {
-    value.fetch_add(1);
-  }
-
-  int64_t get() const override
-  {
-    return value.load();
-  }
-};
+  std::optional<StackType> stack;
+  uint64_t peak_pending = 0;
+  RunResult run = run_trials(
+      plan_for(num_threads, operations_per_thread), measurement,
+      [&]()
+      {
+        stack.emplace();
+        for (int i = 0; i < stack_depth; i++)
+        {
+          stack->push(i);
+        }
+      },
+      [&](int, auto more, ThreadLatency *)
+      {
+        long done = 0;
+        int64_t value;
+        for (; more(done); done++)
+        {
+          stack->push(done);
+          stack->pop(value);
+        }
+        return done;
+      },
+      [&](long)
+      {
+        peak_pending = std::max(peak_pending, stack->reclamation().peakPending);
+        int64_t value;
+        long left = 0;
+        while (stack->pop(value))
+        {
+          left++;
+        }
+        return left == stack_depth;
+      });
+  peak_bytes = (stack_depth + num_threads + peak_pending) * StackType::node_bytes;
+  return run;
+}
 
-// Test function to verify counter correctness
-bool testCounter(Counter &counter, int num_threads, int operations_per_thread)
+// "0.0313 seconds (median of 5, stddev 2.1%)", plus the hardware counters
+// per increment with --perf
+std::string describe_run(const RunResult &run)
 {
-  std::vector<std::thread> threads;
-  std::atomic<bool> start{false};
-
-  // Create threads
-  for (int i = 0; i < num_threads; ++i)
+  std::ostringstream out;
+  out << run.seconds << " seconds (median of " << run.trials.size() - run.rejected
+      << ", stddev " << std::fixed << std::setprecision(1) << 100 * run.relative_stddev() << "%)";
+  if (!run.correct)
   {
-    threads.emplace_back([&counter, operations_per_thread, &start]()
-                         {
-      while (!start) {
-          std::this_thread::yield();
-      }
-      for (int j = 0; j < operations_per_thread; ++j) {
-          counter.increment();
-      } });
+    out << " WRONG COUNT";
   }
-
-  // Start all threads simultaneously
-  start = true;
-
-  // Wait for all threads to complete
-  for (auto &thread : threads)
+  if (run.hasPerf)
   {
-    thread.join();
+    out << "  [" << format_perf(run.perf, run.measuredOperations) << "]";
   }
-
-  // Verify final count
-  return counter.get() == num_threads * operations_per_thread;
+  return out.str();
 }
 
-// Benchmark function
-double benchmarkCounter(Counter &counter, int num_threads, int operations_per_thread)
+int main(int argc, char **argv)
 {
-  std::vector<std::thread> threads;
-  std::atomic<bool> start{false};
-
-  auto start_time = std::chrono::high_resolution_clock::now();
-
-  // Create threads
-  for (int i = 0; i < num_threads; ++i)
+  for (int i = 1; i < argc; i++)
   {
-    threads.emplace_back([&counter, operations_per_thread, &start]()
-                         {
-            while (!start) {
-                std::this_thread::yield();
-            }
-            for (int j = 0; j < operations_per_thread; ++j) {
-                counter.increment();
-            } });
-  }
-
-  // Start all threads simultaneously
-  start = true;
-
-  // Wait for all threads to complete
-  for (auto &thread : threads)
-  {
-    thread.join();
+    if (std::strcmp(argv[i], "--perf") == 0)
+    {
+      measurement.perf = true;
+    }
+    else if (std::strncmp(argv[i], "--warmup=", 9) == 0)
+    {
+      measurement.warmup = std::atoi(argv[i] + 9);
+    }
+    else if (std::strncmp(argv[i], "--trials=", 9) == 0 && std::atoi(argv[i] + 9) > 0)
+    {
+      measurement.trials = std::atoi(argv[i] + 9);
+    }
+    else if (std::strncmp(argv[i], "--placement=", 12) == 0 && parse_placement(argv[i] + 12, placement))
+    {
+      // parsed
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [--perf] [--warmup=N] [--trials=N] [--placement=none|compact|scatter|smt-first|one-per-socket]"
+                << std::endl;
+      return 2;
+    }
   }
+  std::cout << "Placement: " << placement_name(placement) << ", CPUs in thread order: "
+            << describe_cpus(placement_cpus(placement, CpuTopology::get().all().size())) << "\n";
 
-  auto end_time = std::chrono::high_resolution_clock::now();
-  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-
-  return duration.count() / 1000000.0; // Convert to seconds
-}
 
-int main()
-{
   const int num_threads = 4;
   const int operations_per_thread = 1000000;
 
-  // Create counter instances
-  MutexCounter mutex_counter;
-  CompareSwapCounter compare_swap_counter;
-  FetchAddCounter fetch_add_counter;
-
   // Test correctness
   std::cout << "Testing counter implementations...\n";
-  std::cout << "Mutex Counter: " << (testCounter(mutex_counter, num_threads, operations_per_thread) ? "PASSED" : "FAILED") << "\n";
-  std::cout << "Compare-Swap Counter: " << (testCounter(compare_swap_counter, num_threads, operations_per_thread) ? "PASSED" : "FAILED") << "\n";
-  std::cout << "Fetch-Add Counter: " << (testCounter(fetch_add_counter, num_threads, operations_per_thread) ? "PASSED" : "FAILED") << "\n\n";
+  std::cout << "Mutex Counter: " << (testCounter<MutexCounter>(num_threads, operations_per_thread) ? "PASSED" : "FAILED") << "\n";
+  std::cout << "Compare-Swap Counter: " << (testCounter<CompareSwapCounter>(num_threads, operations_per_thread) ? "PASSED" : "FAILED") << "\n";
+  std::cout << "Relaxed Compare-Swap Counter: " << (testCounter<RelaxedCompareSwapCounter>(num_threads, operations_per_thread) ? "PASSED" : "FAILED") << "\n";
+  std::cout << "Fetch-Add Counter: " << (testCounter<FetchAddCounter>(num_threads, operations_per_thread) ? "PASSED" : "FAILED") << "\n";
+  std::cout << "Relaxed Fetch-Add Counter: " << (testCounter<RelaxedFetchAddCounter>(num_threads, operations_per_thread) ? "PASSED" : "FAILED") << "\n";
+  std::cout << "Sharded Counter: " << (testCounter<ShardedCounter>(num_threads, operations_per_thread) ? "PASSED" : "FAILED") << "\n";
+  std::cout << "Flat-Combining Counter: " << (testCounter<FlatCombiningCounter>(num_threads, operations_per_thread) ? "PASSED" : "FAILED") << "\n";
+  std::cout << "Delegation Counter: " << (testCounter<DelegationCounter>(num_threads, operations_per_thread) ? "PASSED" : "FAILED") << "\n\n";
 
   // Benchmark performance
   std::cout << "Benchmarking counter implementations...\n";
   std::cout << "Number of threads: " << num_threads << "\n";
-  std::cout << "Operations per thread: " << operations_per_thread << "\n\n";
-
-  std::cout << "Mutex Counter time: " << benchmarkCounter(mutex_counter, num_threads, operations_per_thread) << " seconds\n";
-  std::cout << "Compare-Swap Counter time: " << benchmarkCounter(compare_swap_counter, num_threads, operations_per_thread) << " seconds\n";
-  std::cout << "Fetch-Add Counter time: " << benchmarkCounter(fetch_add_counter, num_threads, operations_per_thread) << " seconds\n";
+  std::cout << "Operations per thread: " << operations_per_thread << "\n";
+  std::cout << "Trials: " << measurement.warmup << " warmup, " << measurement.trials << " timed\n\n";
+
+  std::cout << "Mutex Counter time: " << describe_run(benchmarkCounter<MutexCounter>(num_threads, operations_per_thread)) << "\n";
+  std::cout << "Compare-Swap Counter time: " << describe_run(benchmarkCounter<CompareSwapCounter>(num_threads, operations_per_thread)) << "\n";
+  std::cout << "Relaxed Compare-Swap Counter time: " << describe_run(benchmarkCounter<RelaxedCompareSwapCounter>(num_threads, operations_per_thread)) << "\n";
+  std::cout << "Fetch-Add Counter time: " << describe_run(benchmarkCounter<FetchAddCounter>(num_threads, operations_per_thread)) << "\n";
+  std::cout << "Relaxed Fetch-Add Counter time: " << describe_run(benchmarkCounter<RelaxedFetchAddCounter>(num_threads, operations_per_thread)) << "\n";
+  std::cout << "Sharded Counter time: " << describe_run(benchmarkCounter<ShardedCounter>(num_threads, operations_per_thread)) << "\n";
+  std::cout << "Flat-Combining Counter time: " << describe_run(benchmarkCounter<FlatCombiningCounter>(num_threads, operations_per_thread)) << "\n";
+  std::cout << "Delegation Counter time: " << describe_run(benchmarkCounter<DelegationCounter>(num_threads, operations_per_thread)) << "\n";
+
+  std::cout << "\nPer-thread counters in one array (" << sizeof(FetchAddCounter) << "-byte counters, "
+            << CACHE_LINE_SIZE << "-byte lines)\n";
+  std::cout << "Packed time: " << describe_run(benchmarkCounterArray<NoPadding>(num_threads, operations_per_thread)) << "\n";
+  std::cout << "Line-padded time: " << describe_run(benchmarkCounterArray<CacheLinePadding>(num_threads, operations_per_thread)) << "\n";
+  std::cout << "Pair-padded time: " << describe_run(benchmarkCounterArray<AdjacentLinePadding>(num_threads, operations_per_thread)) << "\n";
+
+  // Lock-free stacks need their popped nodes reclaimed; the locked one
+  // frees them on the spot
+  std::cout << "\nStack push+pop, " << stack_depth << " nodes deep\n";
+  uint64_t peak_bytes = 0;
+  std::cout << "Treiber Stack, epochs time: " << describe_run(benchmarkStack<LockFreeStack<int64_t, EpochDomain>>(num_threads, operations_per_thread, peak_bytes));
+  std::cout << ", peak memory " << peak_bytes / 1024.0 << " KiB\n";
+  std::cout << "Treiber Stack, hazard pointers time: " << describe_run(benchmarkStack<LockFreeStack<int64_t, HazardDomain>>(num_threads, operations_per_thread, peak_bytes));
+  std::cout << ", peak memory " << peak_bytes / 1024.0 << " KiB\n";
+  std::cout << "TTASLock Stack time: " << describe_run(benchmarkStack<LockedStack<int64_t, TTASLock>>(num_threads, operations_per_thread, peak_bytes));
+  std::cout << ", peak memory " << peak_bytes / 1024.0 << " KiB\n";
+
+  // Scaling: throughput of the contended and the sharded counter as threads
+  // double, ending on the maximum even when it is not a power of two
+  const int max_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::cout << "\nScaling up to " << max_threads << " threads (million increments/second)\n";
+  std::cout << "Threads  Fetch-Add  Sharded\n";
+  for (int threads = 1;; threads = std::min(threads * 2, max_threads))
+  {
+    std::cout << threads
+              << "  " << benchmarkCounter<FetchAddCounter>(threads, operations_per_thread).ops_per_second() / 1e6
+              << "  " << benchmarkCounter<ShardedCounter>(threads, operations_per_thread).ops_per_second() / 1e6 << "\n";
+    if (threads == max_threads)
+    {
+      break;
+    }
+  }
 
   return 0;
 }
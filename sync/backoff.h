@@ -0,0 +1,104 @@
+#ifndef SYNC_BACKOFF_H
+#define SYNC_BACKOFF_H
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include "config.h"
+#include "futex.h"
+
+// Backoff policies: what a primitive does after a failed attempt. A fresh
+// instance is created for every acquire/wait, so escalation state lives in
+// the object and starts over each time.
+
+struct NoBackoff {
+    void operator()() {}
+};
+
+// Tuning knobs for Backoff<Policy>. Override any subset by deriving:
+//   struct ShortBackoff : DefaultBackoffPolicy {
+//       static constexpr unsigned max_spins = 64;
+//   };
+struct DefaultBackoffPolicy {
+    // Tier 1: spin on cpu_relax(), doubling from min_spins to max_spins.
+    static constexpr unsigned min_spins = 4;
+    static constexpr unsigned max_spins = 1024;
+    // Tier 2: give the core away with sched_yield this many times.
+    static constexpr unsigned yield_rounds = 4;
+    // Tier 3: sleep on a futex, doubling from min_sleep_ns to max_sleep_ns.
+    static constexpr int64_t min_sleep_ns = 1000;
+    static constexpr int64_t max_sleep_ns = 1000000;
+    // Draw each delay uniformly from [delay/2, delay] so that waiters that
+    // failed together do not retry together.
+    static constexpr bool jitter = true;
+};
+
+// Escalating backoff: pause -> yield -> futex sleep. The pause tier costs
+// nanoseconds, so short handoffs are not punished with a syscall the way a
+// plain sleep_for would.
+template <typename Policy = DefaultBackoffPolicy>
+class Backoff {
+    static_assert(Policy::min_spins > 0 && Policy::min_spins <= Policy::max_spins);
+    static_assert(Policy::min_sleep_ns > 0 && Policy::min_sleep_ns <= Policy::max_sleep_ns);
+
+private:
+    unsigned spins = Policy::min_spins;
+    unsigned yields = 0;
+    int64_t sleep_ns = Policy::min_sleep_ns;
+
+    // xorshift32; one stream per thread, seeded from its address.
+    static uint32_t next_random() {
+        thread_local uint32_t state = static_cast<uint32_t>(
+            reinterpret_cast<uintptr_t>(&state) >> 4) | 1;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    template <typename T>
+    static T jittered(T delay) {
+        if constexpr (Policy::jitter) {
+            T half = delay / 2;
+            return half + static_cast<T>(next_random() % (delay - half + 1));
+        } else {
+            return delay;
+        }
+    }
+
+    static void sleep_for_ns(int64_t ns) {
+        // Nobody ever wakes this word; the futex is only a cheap timed sleep.
+        thread_local std::atomic<uint32_t> word{0};
+        futex_wait_for(word, 0, std::chrono::nanoseconds(ns));
+    }
+
+public:
+    static constexpr unsigned min_spins = Policy::min_spins;
+    static constexpr unsigned max_spins = Policy::max_spins;
+    static constexpr unsigned yield_rounds = Policy::yield_rounds;
+    static constexpr int64_t min_sleep_ns = Policy::min_sleep_ns;
+    static constexpr int64_t max_sleep_ns = Policy::max_sleep_ns;
+
+    void operator()() {
+        if (spins <= Policy::max_spins) {
+            for (unsigned i = jittered(spins); i > 0; i--) {
+                cpu_relax();
+            }
+            spins *= 2;
+            return;
+        }
+
+        if (yields < Policy::yield_rounds) {
+            yields++;
+            std::this_thread::yield();
+            return;
+        }
+
+        sleep_for_ns(jittered(sleep_ns));
+        sleep_ns = std::min(sleep_ns * 2, Policy::max_sleep_ns);
+    }
+};
+
+#endif
@@ -0,0 +1,374 @@
+#ifndef SYNC_BARRIER_H
+#define SYNC_BARRIER_H
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <concepts>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include "policy.h"
+#include "park.h"
+#include "config.h"
+
+// Every barrier offers a blocking wait() for a fixed party of threads.
+template <typename B>
+concept Barrier = requires(B& b) {
+    b.wait();
+};
+
+// Barriers that also split wait() into arrive() and wait(token).
+template <typename B>
+concept SplitBarrier = Barrier<B> && requires(B& b) {
+    b.wait(b.arrive());
+};
+
+// Backoff used while waiting for the sense to flip.
+using BarrierBackoff = Backoff<>;
+
+// Default completion step: nothing.
+struct NoCompletion
+{
+  void operator()() noexcept {}
+};
+
+// Park = NeverPark polls the sense with BackoffType between polls. With
+// SpinThenPark the waiter spins and yields as the policy says, then sleeps
+// on the sense word until the last arriver flips it and wakes everyone.
+//
+// CompletionFunction runs once per phase on the last thread to arrive,
+// after every thread has arrived and before any is released, like
+// std::barrier's completion step. Its writes are visible to every thread
+// once it leaves wait().
+//
+// wait() is arrive() followed by wait(token). Splitting them lets a thread
+// do independent work while the stragglers arrive. A thread must wait on
+// its token before it arrives again.
+//
+// Ordering = MinimalOrdering keeps exactly the edges the barrier promises:
+// each arrival releases the thread's writes into count, the last arriver
+// acquires them all before completion() and releases everything with the
+// sense flip, and the waiters acquire the flip.
+template <typename BackoffType = BarrierBackoff, typename Padding = NoPadding, typename Park = NeverPark,
+          typename CompletionFunction = NoCompletion, typename Ordering = SequentialOrdering>
+class BasicSenseReversingBarrier
+{
+private:
+  alignas(Padding::alignment) alignas(std::atomic<int>) std::atomic<int> count;
+  alignas(Padding::alignment) alignas(std::atomic<bool>) std::atomic<bool> sense;
+  const int num_threads;
+  [[no_unique_address]] CompletionFunction completion;
+
+public:
+  // Names the phase a thread arrived at.
+  class ArrivalToken
+  {
+  private:
+    bool phase_sense;
+    explicit ArrivalToken(bool phase_sense) : phase_sense(phase_sense) {}
+    friend class BasicSenseReversingBarrier;
+  };
+
+  BasicSenseReversingBarrier(int n, CompletionFunction completion = CompletionFunction())
+      : count(n), sense(true), num_threads(n), completion(std::move(completion)) {}
+
+  [[nodiscard]] ArrivalToken arrive()
+  {
+    // The phase's sense, read before arriving: it cannot flip until this
+    // thread has arrived. Reading it rather than keeping a thread_local
+    // copy lets long-lived threads (a worker pool) use any number of
+    // barriers of the same type, each starting fresh. Needs no ordering:
+    // the thread saw the last flip itself, or it came before the thread's
+    // first arrival.
+    bool my_sense_local = sense.load(Ordering::relaxed);
+
+    // count = 1 means the last thread to arrive
+    if (count.fetch_sub(1, Ordering::release) == 1)
+    {
+      // see what every other thread wrote before it arrived
+      Ordering::acquire_fence();
+
+      // every other thread has arrived and none can leave yet
+      completion();
+
+      // Reset count; the release below publishes it
+      count.store(num_threads, Ordering::relaxed);
+
+      // before other threads see the flipped sense.
+      sense.store(!my_sense_local, Ordering::release);
+      if constexpr (Park::parks)
+      {
+        sense.notify_all();
+      }
+    }
+
+    return ArrivalToken(my_sense_local);
+  }
+
+  void wait(ArrivalToken token)
+  {
+    bool my_sense_local = token.phase_sense;
+
+    if constexpr (Park::parks)
+    {
+      unsigned polls = 0;
+      while (sense.load(Ordering::acquire) == my_sense_local)
+      {
+        if (polls < Park::spin_limit)
+        {
+          cpu_relax();
+        }
+        else if (polls < Park::spin_limit + Park::yield_limit)
+        {
+          std::this_thread::yield();
+        }
+        else
+        {
+          sense.wait(my_sense_local);
+        }
+        polls++;
+      }
+    }
+    else
+    {
+      BackoffType backoff;
+      // Wait for the sense to flip by last thread
+      while (sense.load(Ordering::acquire) == my_sense_local)
+      {
+        backoff();
+      }
+    }
+  }
+
+  void wait()
+  {
+    wait(arrive());
+  }
+};
+
+using SenseReversingBarrier = BasicSenseReversingBarrier<>;
+using ParkingSenseReversingBarrier = BasicSenseReversingBarrier<BarrierBackoff, NoPadding, SpinThenPark<>>;
+using RelaxedSenseReversingBarrier =
+    BasicSenseReversingBarrier<BarrierBackoff, NoPadding, NeverPark, NoCompletion, MinimalOrdering>;
+
+// Sense-reversing barrier that runs completion() at the end of each phase.
+template <typename CompletionFunction>
+using CompletionBarrier = BasicSenseReversingBarrier<BarrierBackoff, NoPadding, NeverPark, CompletionFunction>;
+
+static_assert(Barrier<SenseReversingBarrier>);
+static_assert(Barrier<ParkingSenseReversingBarrier>);
+static_assert(Barrier<RelaxedSenseReversingBarrier>);
+static_assert(SplitBarrier<SenseReversingBarrier>);
+
+// Dense per-barrier thread ids, so barriers that need to know who is
+// calling can still offer the plain wait(). A thread takes the next id the
+// first time it waits on a given barrier and keeps it for that barrier's
+// lifetime; barriers are told apart by a serial number, not their address,
+// so a new barrier at a recycled address does not inherit stale ids.
+class BarrierThreadIds
+{
+private:
+  const uint64_t serial;
+  std::atomic<int> next_id{0};
+
+  static uint64_t next_serial()
+  {
+    static std::atomic<uint64_t> serials{0};
+    return serials.fetch_add(1, std::memory_order_relaxed);
+  }
+
+public:
+  BarrierThreadIds() : serial(next_serial()) {}
+
+  int get()
+  {
+    thread_local std::vector<std::pair<uint64_t, int>> ids;
+    if (!ids.empty() && ids.back().first == serial)
+    {
+      return ids.back().second;
+    }
+    for (auto &entry : ids)
+    {
+      if (entry.first == serial)
+      {
+        return entry.second;
+      }
+    }
+    int id = next_id.fetch_add(1, std::memory_order_relaxed);
+    ids.emplace_back(serial, id);
+    return id;
+  }
+};
+
+// A flag on its own cache line.
+struct alignas(CACHE_LINE_SIZE) PaddedFlag
+{
+  std::atomic<bool> value{false};
+};
+
+// Rounds needed to cover n threads by doubling: ceil(log2(n)).
+inline int barrier_rounds(int n)
+{
+  int rounds = 0;
+  while ((1 << rounds) < n)
+  {
+    rounds++;
+  }
+  return rounds;
+}
+
+// Static tournament barrier (Hensgen, Finkel & Manber; Mellor-Crummey &
+// Scott). In round k thread i plays i ^ 2^k: the loser signals the winner's
+// per-round flag and drops out, the winner advances. Thread 0 is the
+// champion; it releases the losers it beat, and each of them releases the
+// ones it beat, back down the tree. Every flag is padded and written by
+// exactly one thread per episode, so arrival and wake-up are O(log n)
+// without a shared counter. At most n threads may call wait(); pass id
+// explicitly (0..n-1) when the caller already knows it.
+template <typename BackoffType = BarrierBackoff>
+class BasicTournamentBarrier
+{
+private:
+  struct alignas(CACHE_LINE_SIZE) ThreadState
+  {
+    bool sense = true; // owned by the thread
+  };
+
+  const int num_threads;
+  const int rounds;
+  std::unique_ptr<PaddedFlag[]> arrive; // [thread][round]
+  std::unique_ptr<PaddedFlag[]> wakeup; // [thread]
+  std::unique_ptr<ThreadState[]> state;
+  BarrierThreadIds ids;
+
+  template <typename Pred>
+  static void spin_until(Pred done)
+  {
+    BackoffType backoff;
+    while (!done())
+    {
+      backoff();
+    }
+  }
+
+public:
+  BasicTournamentBarrier(int n)
+      : num_threads(n), rounds(barrier_rounds(n)),
+        arrive(new PaddedFlag[n * std::max(1, barrier_rounds(n))]),
+        wakeup(new PaddedFlag[n]), state(new ThreadState[n]) {}
+
+  void wait() { wait(ids.get()); }
+
+  void wait(int id)
+  {
+    bool my_sense = state[id].sense;
+
+    // Arrival: climb until we lose or win the final.
+    int reached = rounds;
+    for (int k = 0; k < rounds; k++)
+    {
+      int step = 1 << k;
+      if (id & step)
+      {
+        // loser: tell the winner, then wait to be released
+        arrive[(id - step) * rounds + k].value.store(my_sense, std::memory_order_release);
+        spin_until([&]
+                   { return wakeup[id].value.load(std::memory_order_acquire) == my_sense; });
+        reached = k;
+        break;
+      }
+      if (id + step < num_threads)
+      {
+        // winner: wait for this round's opponent (otherwise a bye)
+        std::atomic<bool> &flag = arrive[id * rounds + k].value;
+        spin_until([&]
+                   { return flag.load(std::memory_order_acquire) == my_sense; });
+      }
+    }
+
+    // Wake-up: release everyone we beat, latest round first.
+    for (int k = reached - 1; k >= 0; k--)
+    {
+      int opponent = id + (1 << k);
+      if (opponent < num_threads)
+      {
+        wakeup[opponent].value.store(my_sense, std::memory_order_release);
+      }
+    }
+
+    state[id].sense = !my_sense;
+  }
+};
+
+// Dissemination barrier (Hensgen, Finkel & Manber). In round k thread i
+// signals thread (i + 2^k) mod n and waits for thread (i - 2^k) mod n;
+// after ceil(log2 n) rounds everyone has transitively heard from everyone.
+// There is no wake-up phase and no single hot line, at the cost of
+// n log n flag writes per episode. Flags alternate between two parity
+// sets and reuse is handled with sense reversal, as in Mellor-Crummey &
+// Scott. At most n threads may call wait(); pass id explicitly (0..n-1)
+// when the caller already knows it.
+template <typename BackoffType = BarrierBackoff>
+class BasicDisseminationBarrier
+{
+private:
+  struct alignas(CACHE_LINE_SIZE) ThreadState
+  {
+    // owned by the thread
+    int parity = 0;
+    bool sense = true;
+  };
+
+  const int num_threads;
+  const int rounds;
+  std::unique_ptr<PaddedFlag[]> flags; // [thread][parity][round]
+  std::unique_ptr<ThreadState[]> state;
+  BarrierThreadIds ids;
+
+  std::atomic<bool> &flag(int thread, int parity, int round)
+  {
+    return flags[(thread * 2 + parity) * rounds + round].value;
+  }
+
+public:
+  BasicDisseminationBarrier(int n)
+      : num_threads(n), rounds(barrier_rounds(n)),
+        flags(new PaddedFlag[n * 2 * std::max(1, barrier_rounds(n))]),
+        state(new ThreadState[n]) {}
+
+  void wait() { wait(ids.get()); }
+
+  void wait(int id)
+  {
+    ThreadState &me = state[id];
+
+    for (int k = 0; k < rounds; k++)
+    {
+      int partner = (id + (1 << k)) % num_threads;
+      flag(partner, me.parity, k).store(me.sense, std::memory_order_release);
+
+      std::atomic<bool> &mine = flag(id, me.parity, k);
+      BackoffType backoff;
+      while (mine.load(std::memory_order_acquire) != me.sense)
+      {
+        backoff();
+      }
+    }
+
+    if (me.parity == 1)
+    {
+      me.sense = !me.sense;
+    }
+    me.parity = 1 - me.parity;
+  }
+};
+
+using TournamentBarrier = BasicTournamentBarrier<>;
+using DisseminationBarrier = BasicDisseminationBarrier<>;
+
+static_assert(Barrier<TournamentBarrier>);
+static_assert(Barrier<DisseminationBarrier>);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SYNC_CLOCK_H
+#define SYNC_CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Reads the CPU's timestamp counter (rdtsc on x86, the virtual counter on
+// ARM); elsewhere falls back to steady_clock nanoseconds. Cheap enough to
+// call around every lock acquisition.
+inline uint64_t read_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// Nanoseconds per tick, calibrated once against steady_clock.
+inline double ns_per_tick() {
+    static const double rate = []() {
+        auto wallStart = std::chrono::steady_clock::now();
+        uint64_t tickStart = read_ticks();
+        while (std::chrono::steady_clock::now() - wallStart < std::chrono::milliseconds(20)) {
+        }
+        uint64_t tickEnd = read_ticks();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - wallStart).count();
+        return tickEnd > tickStart ? ns / (tickEnd - tickStart) : 1.0;
+    }();
+    return rate;
+}
+
+#endif
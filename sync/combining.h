@@ -0,0 +1,148 @@
+#ifndef SYNC_COMBINING_H
+#define SYNC_COMBINING_H
+
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include "config.h"
+
+// Flat combining (Hendler et al.): instead of every thread taking the lock
+// in turn, threads publish requests into per-thread slots and whichever
+// thread wins the combiner role applies all pending requests in one pass.
+// The protected state stays in the combiner's cache, and n requests cost
+// one lock acquisition instead of n handoffs.
+//
+// Op holds the sequential object and describes it:
+//   struct Op {
+//       using request_type = ...;
+//       using result_type = ...;
+//       result_type apply(const request_type&);
+//   };
+// apply() only ever runs in the combiner, one request at a time.
+template <typename Op>
+class FlatCombiner {
+public:
+    using request_type = typename Op::request_type;
+    using result_type = typename Op::result_type;
+
+private:
+    enum : uint32_t { SLOT_FREE, SLOT_WRITING, SLOT_PENDING, SLOT_DONE };
+
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        std::atomic<uint32_t> state{SLOT_FREE};
+        request_type request{};
+        result_type result{};
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    const unsigned numSlots;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> combining{false};
+    alignas(CACHE_LINE_SIZE) Op op;
+
+    static unsigned thread_slot() {
+        static std::atomic<unsigned> nextSlot{0};
+        thread_local unsigned slot = nextSlot.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+
+    bool try_become_combiner() {
+        return !combining.load(std::memory_order_relaxed) &&
+               !combining.exchange(true, std::memory_order_acquire);
+    }
+
+    void stop_combining() {
+        combining.store(false, std::memory_order_release);
+    }
+
+    // One pass over every slot; only the combiner calls this.
+    void combine() {
+        for (unsigned i = 0; i < numSlots; i++) {
+            Slot& slot = slots[i];
+            if (slot.state.load(std::memory_order_acquire) == SLOT_PENDING) {
+                slot.result = op.apply(slot.request);
+                slot.state.store(SLOT_DONE, std::memory_order_release);
+            }
+        }
+    }
+
+public:
+    template <typename... Args>
+    explicit FlatCombiner(unsigned numSlots, Args&&... args)
+        : slots(new Slot[numSlots]), numSlots(numSlots), op(std::forward<Args>(args)...) {}
+
+    FlatCombiner() : FlatCombiner(std::max(1u, std::thread::hardware_concurrency())) {}
+
+    result_type execute(const request_type& request) {
+        Slot& slot = slots[thread_slot() % numSlots];
+
+        uint32_t expected = SLOT_FREE;
+        if (!slot.state.compare_exchange_strong(expected, SLOT_WRITING, std::memory_order_acquire)) {
+            // More threads than slots and ours is taken: become the
+            // combiner ourselves and apply the request directly.
+            while (!try_become_combiner()) {
+                cpu_relax();
+            }
+            combine();
+            result_type result = op.apply(request);
+            stop_combining();
+            return result;
+        }
+
+        slot.request = request;
+        slot.state.store(SLOT_PENDING, std::memory_order_release);
+
+        while (slot.state.load(std::memory_order_acquire) != SLOT_DONE) {
+            if (try_become_combiner()) {
+                combine();
+                stop_combining();
+            } else {
+                cpu_relax();
+            }
+        }
+
+        result_type result = slot.result;
+        slot.state.store(SLOT_FREE, std::memory_order_release);
+        return result;
+    }
+
+    // The sequential object. Only safe to touch where apply() could not be
+    // running concurrently, or through members that are atomic themselves.
+    Op& object() { return op; }
+    const Op& object() const { return op; }
+};
+
+// A lock whose critical sections are shipped to the combiner as closures:
+// under contention one thread runs everybody's sections back to back.
+class CombiningLock {
+private:
+    struct ClosureOp {
+        struct request_type {
+            void (*invoke)(void*) = nullptr;
+            void* closure = nullptr;
+        };
+        using result_type = bool;
+
+        bool apply(const request_type& request) {
+            request.invoke(request.closure);
+            return true;
+        }
+    };
+
+    FlatCombiner<ClosureOp> combiner;
+
+public:
+    // Runs critical_section() under mutual exclusion with every other
+    // section run through this lock, possibly on another thread.
+    template <typename F>
+    void execute(F& critical_section) {
+        typename ClosureOp::request_type request;
+        request.invoke = [](void* closure) { (*static_cast<F*>(closure))(); };
+        request.closure = &critical_section;
+        combiner.execute(request);
+    }
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SYNC_CONFIG_H
+#define SYNC_CONFIG_H
+
+#include <cstddef>
+#include <new>
+
+// Size of a cache line on the machines we target; every padded primitive
+// aligns its hot words to this. Taken from the standard library's
+// std::hardware_destructive_interference_size where it has one, else 64;
+// -DSYNC_CACHE_LINE_SIZE=128 overrides it, e.g. to keep Intel's
+// adjacent-line prefetcher from pairing neighbouring lines everywhere.
+#if defined(SYNC_CACHE_LINE_SIZE)
+constexpr std::size_t CACHE_LINE_SIZE = SYNC_CACHE_LINE_SIZE;
+#elif defined(__cpp_lib_hardware_interference_size)
+// GCC warns that the value depends on -mtune; that is what we want here.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winterference-size"
+#endif
+constexpr std::size_t CACHE_LINE_SIZE = std::hardware_destructive_interference_size;
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#else
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+#endif
+
+static_assert((CACHE_LINE_SIZE & (CACHE_LINE_SIZE - 1)) == 0, "CACHE_LINE_SIZE must be a power of two");
+
+// Tell the CPU we are in a spin-wait loop: frees pipeline resources for the
+// SMT sibling and avoids the memory-order mis-speculation flush on exit.
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#else
+    asm volatile("" ::: "memory");
+#endif
+}
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef SYNC_COUNTER_H
+#define SYNC_COUNTER_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <algorithm>
+#include "policy.h"
+#include "combining.h"
+#include "delegation.h"
+
+// Base counter interface. The concrete counters are final, so calls made
+// through the concrete type are devirtualized; only callers that hold a
+// Counter& pay for dispatch.
+class Counter
+{
+public:
+  virtual void increment() = 0;
+  virtual int64_t get() const = 0;
+  virtual ~Counter() {}
+};
+
+// Mutex-based counter
+class MutexCounter final : public Counter
+{
+private:
+  int64_t value;
+  mutable std::mutex mtx;
+
+public:
+  MutexCounter() : value(0) {}
+
+  void increment() override
+  {
+    // lock_guard is = mutex.lock() and mutex.unlock() when it goes out of scope
+    // std::lock_guard<std::mutex> lock(mtx);
+    mtx.lock();
+    value++;
+    mtx.unlock();
+  }
+
+  int64_t get() const override
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    return value;
+  }
+};
+
+// Backoff used between failed CAS attempts.
+using CounterBackoff = Backoff<>;
+
+// CAS-based counter with exponential backoff.
+//
+// Ordering = MinimalOrdering counts with relaxed atomics and a weak CAS.
+// The count is still exact once the writers are quiescent (joined), and
+// get() still sees every increment that happens before it, but an
+// increment no longer orders the caller's other accesses, so the counter
+// must not be used to publish data. The same holds for the fetch-and-add
+// counter below.
+template <typename BackoffType = CounterBackoff, typename Padding = NoPadding, typename Ordering = SequentialOrdering>
+class BasicCompareSwapCounter final : public Counter
+{
+private:
+  alignas(Padding::alignment) alignas(std::atomic<int64_t>) std::atomic<int64_t> value{0};
+
+public:
+  void increment() override
+  {
+    BackoffType backoff;
+    int64_t current = value.load(Ordering::relaxed);
+    // a failed CAS reloads current
+    while (!Ordering::compare_exchange(value, current, current + 1, Ordering::relaxed))
+    {
+      backoff();
+    }
+  }
+
+  int64_t get() const override
+  {
+    return value.load(Ordering::relaxed);
+  }
+};
+
+using CompareSwapCounter = BasicCompareSwapCounter<>;
+using RelaxedCompareSwapCounter = BasicCompareSwapCounter<CounterBackoff, NoPadding, MinimalOrdering>;
+
+// Fetch-and-add based counter
+template <typename Padding = NoPadding, typename Ordering = SequentialOrdering>
+class BasicFetchAddCounter final : public Counter
+{
+private:
+  alignas(Padding::alignment) alignas(std::atomic<int64_t>) std::atomic<int64_t> value{0};
+
+public:
+  void increment() override
+  {
+    value.fetch_add(1, Ordering::relaxed);
+  }
+
+  int64_t get() const override
+  {
+    return value.load(Ordering::relaxed);
+  }
+};
+
+using FetchAddCounter = BasicFetchAddCounter<>;
+using RelaxedFetchAddCounter = BasicFetchAddCounter<NoPadding, MinimalOrdering>;
+
+// Sharded counter: each thread increments its own padded shard, so
+// increments from different cores never share a cache line. Threads get a
+// shard round-robin on first use; with at least as many shards as threads
+// every increment stays core-local. get() sums the shards: the result is
+// exact once writers are quiescent, and otherwise lies between the totals
+// at the start and the end of the call. get_approx() reuses a sum that is
+// at most max_staleness old, for readers that poll often.
+template <typename Padding = CacheLinePadding>
+class BasicShardedCounter final : public Counter
+{
+private:
+  struct alignas(Padding::alignment) alignas(std::atomic<int64_t>) Shard
+  {
+    std::atomic<int64_t> value{0};
+  };
+
+  std::unique_ptr<Shard[]> shards;
+  const unsigned num_shards;
+
+  mutable std::atomic<int64_t> cached_sum{0};
+  mutable std::atomic<int64_t> cached_at_ns{INT64_MIN};
+
+  static unsigned thread_shard()
+  {
+    static std::atomic<unsigned> next_shard{0};
+    thread_local unsigned shard = next_shard.fetch_add(1, std::memory_order_relaxed);
+    return shard;
+  }
+
+  static int64_t now_ns()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+public:
+  explicit BasicShardedCounter(unsigned num_shards = std::max(1u, std::thread::hardware_concurrency()))
+      : shards(new Shard[num_shards]), num_shards(num_shards) {}
+
+  void increment() override
+  {
+    // relaxed RMW: the shard is normally private, so this never bounces
+    shards[thread_shard() % num_shards].value.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  int64_t get() const override
+  {
+    int64_t sum = 0;
+    for (unsigned i = 0; i < num_shards; i++)
+    {
+      sum += shards[i].value.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  int64_t get_approx(std::chrono::nanoseconds max_staleness) const
+  {
+    int64_t now = now_ns();
+    int64_t cached_at = cached_at_ns.load(std::memory_order_acquire);
+    if (cached_at != INT64_MIN && now - cached_at <= max_staleness.count())
+    {
+      return cached_sum.load(std::memory_order_relaxed);
+    }
+
+    int64_t sum = get();
+    cached_sum.store(sum, std::memory_order_relaxed);
+    cached_at_ns.store(now, std::memory_order_release);
+    return sum;
+  }
+};
+
+using ShardedCounter = BasicShardedCounter<>;
+
+// Flat-combining counter: concurrent increments are published to the
+// combiner, which applies a whole batch under one acquisition of the
+// combiner role instead of every thread fighting for the value.
+class FlatCombiningCounter final : public Counter
+{
+private:
+  struct AddOp
+  {
+    using request_type = int64_t;
+    using result_type = int64_t;
+
+    // written only by the combiner, read by get() from any thread
+    std::atomic<int64_t> value{0};
+
+    int64_t apply(const int64_t &delta)
+    {
+      int64_t next = value.load(std::memory_order_relaxed) + delta;
+      value.store(next, std::memory_order_release);
+      return next;
+    }
+  };
+
+  FlatCombiner<AddOp> combiner;
+
+public:
+  void increment() override
+  {
+    combiner.execute(1);
+  }
+
+  int64_t get() const override
+  {
+    return combiner.object().value.load(std::memory_order_acquire);
+  }
+};
+
+// Delegation counter: a server thread owns the value and applies every
+// increment itself, so the value's line never leaves the server's core.
+// Each increment costs a round trip through the caller's mailbox.
+class DelegationCounter final : public Counter
+{
+private:
+  struct AddOp
+  {
+    using request_type = int64_t;
+    using result_type = int64_t;
+
+    // written only by the server, read by get() from any thread
+    std::atomic<int64_t> value{0};
+
+    int64_t apply(const int64_t &delta)
+    {
+      int64_t next = value.load(std::memory_order_relaxed) + delta;
+      value.store(next, std::memory_order_release);
+      return next;
+    }
+  };
+
+  DelegationServer<AddOp> server;
+
+public:
+  void increment() override
+  {
+    server.execute(1);
+  }
+
+  int64_t get() const override
+  {
+    return server.object().value.load(std::memory_order_acquire);
+  }
+};
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef SYNC_DELEGATION_H
+#define SYNC_DELEGATION_H
+
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include "config.h"
+#include "topology.h"
+
+// Delegation, or remote core locking (Lozi et al., RCL): a dedicated
+// server thread owns the protected object and runs every critical section
+// itself. Clients post a request into their own cache-line mailbox and
+// spin on it until the server writes the result back. Neither a lock word
+// nor the protected data ever leaves the server's cache; each operation
+// costs the two transfers of the client's mailbox line instead. The server
+// needs a core of its own: sharing one with its clients turns every
+// request into context switches.
+//
+// Op describes the object exactly as for FlatCombiner:
+//   struct Op {
+//       using request_type = ...;
+//       using result_type = ...;
+//       result_type apply(const request_type&);
+//   };
+// apply() only ever runs on the server thread.
+template <typename Op>
+class DelegationServer {
+public:
+    using request_type = typename Op::request_type;
+    using result_type = typename Op::result_type;
+
+private:
+    enum : uint32_t { MAILBOX_FREE, MAILBOX_WRITING, MAILBOX_PENDING, MAILBOX_DONE };
+
+    // Polls this many times before yielding, so a server or client sharing
+    // its core with the thread it waits for still makes progress.
+    static constexpr unsigned SPINS_BEFORE_YIELD = 128;
+
+    struct alignas(CACHE_LINE_SIZE) Mailbox {
+        std::atomic<uint32_t> state{MAILBOX_FREE};
+        request_type request{};
+        result_type result{};
+    };
+
+    std::unique_ptr<Mailbox[]> mailboxes;
+    const unsigned numMailboxes;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> stopping{false};
+    alignas(CACHE_LINE_SIZE) Op op;
+    std::thread server;
+
+    static unsigned thread_mailbox() {
+        static std::atomic<unsigned> nextMailbox{0};
+        thread_local unsigned mailbox = nextMailbox.fetch_add(1, std::memory_order_relaxed);
+        return mailbox;
+    }
+
+    static void wait_round(unsigned& rounds) {
+        if (++rounds < SPINS_BEFORE_YIELD) {
+            cpu_relax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    // One pass over every mailbox; returns the number of requests served.
+    unsigned serve() {
+        unsigned served = 0;
+        for (unsigned i = 0; i < numMailboxes; i++) {
+            Mailbox& mailbox = mailboxes[i];
+            if (mailbox.state.load(std::memory_order_acquire) == MAILBOX_PENDING) {
+                mailbox.result = op.apply(mailbox.request);
+                mailbox.state.store(MAILBOX_DONE, std::memory_order_release);
+                served++;
+            }
+        }
+        return served;
+    }
+
+    void run(int cpu) {
+        if (cpu >= 0) {
+            pin_current_thread(cpu);
+        }
+        unsigned idle = 0;
+        while (!stopping.load(std::memory_order_acquire)) {
+            if (serve() > 0) {
+                idle = 0;
+            } else {
+                wait_round(idle);
+            }
+        }
+        serve(); // clients may still be waiting on a request posted before the stop
+    }
+
+public:
+    // Starts the server thread, pinned to serverCpu unless it is negative.
+    // Threads beyond numMailboxes share mailboxes and wait for each other.
+    template <typename... Args>
+    explicit DelegationServer(unsigned numMailboxes, int serverCpu, Args&&... args)
+        : mailboxes(new Mailbox[numMailboxes]), numMailboxes(numMailboxes), op(std::forward<Args>(args)...) {
+        server = std::thread([this, serverCpu]() { run(serverCpu); });
+    }
+
+    DelegationServer() : DelegationServer(std::max(1u, std::thread::hardware_concurrency()), -1) {}
+
+    DelegationServer(const DelegationServer&) = delete;
+    DelegationServer& operator=(const DelegationServer&) = delete;
+
+    // Every execute() must have returned before the server is destroyed.
+    ~DelegationServer() {
+        stopping.store(true, std::memory_order_release);
+        server.join();
+    }
+
+    result_type execute(const request_type& request) {
+        Mailbox& mailbox = mailboxes[thread_mailbox() % numMailboxes];
+
+        unsigned rounds = 0;
+        uint32_t expected = MAILBOX_FREE;
+        while (!mailbox.state.compare_exchange_weak(expected, MAILBOX_WRITING, std::memory_order_acquire)) {
+            // shared with another thread that has a request in flight
+            expected = MAILBOX_FREE;
+            wait_round(rounds);
+        }
+
+        mailbox.request = request;
+        mailbox.state.store(MAILBOX_PENDING, std::memory_order_release);
+
+        rounds = 0;
+        while (mailbox.state.load(std::memory_order_acquire) != MAILBOX_DONE) {
+            wait_round(rounds);
+        }
+
+        result_type result = mailbox.result;
+        mailbox.state.store(MAILBOX_FREE, std::memory_order_release);
+        return result;
+    }
+
+    // The object. Only safe to touch where apply() could not be running
+    // concurrently, or through members that are atomic themselves.
+    Op& object() { return op; }
+    const Op& object() const { return op; }
+};
+
+// A lock whose critical sections are shipped to the server thread as
+// closures, so every section runs on the same core.
+class DelegationLock {
+private:
+    struct ClosureOp {
+        struct request_type {
+            void (*invoke)(void*) = nullptr;
+            void* closure = nullptr;
+        };
+        using result_type = bool;
+
+        bool apply(const request_type& request) {
+            request.invoke(request.closure);
+            return true;
+        }
+    };
+
+    DelegationServer<ClosureOp> server;
+
+public:
+    DelegationLock() = default;
+
+    // Pins the server thread to serverCpu.
+    DelegationLock(unsigned numMailboxes, int serverCpu) : server(numMailboxes, serverCpu) {}
+
+    // Runs critical_section() on the server thread, mutually exclusive with
+    // every other section run through this lock.
+    template <typename F>
+    void execute(F& critical_section) {
+        typename ClosureOp::request_type request;
+        request.invoke = [](void* closure) { (*static_cast<F*>(closure))(); };
+        request.closure = &critical_section;
+        server.execute(request);
+    }
+};
+
+#endif
@@ -0,0 +1,229 @@
+#ifndef SYNC_ELISION_H
+#define SYNC_ELISION_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <algorithm>
+#include "config.h"
+#include "lock.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SYNC_HAVE_RTM_INTRINSICS 1
+#define SYNC_RTM_TARGET __attribute__((target("rtm")))
+#else
+#define SYNC_HAVE_RTM_INTRINSICS 0
+#define SYNC_RTM_TARGET
+#endif
+
+// True if the CPU offers Intel RTM (CPUID.7.0:EBX bit 11). Checked at run
+// time, so one binary runs everywhere. CPUs whose TSX was disabled by
+// microcode report false here or abort every transaction; both end up on
+// the fallback lock.
+inline bool rtm_supported() {
+#if SYNC_HAVE_RTM_INTRINSICS
+    static const bool supported = []() {
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        return (ebx & (1u << 11)) != 0;
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+// Why elided critical sections ended, summed over threads.
+struct ElisionStats {
+    uint64_t commits = 0;       // ran as a transaction
+    uint64_t fallbacks = 0;     // ran under the fallback lock
+    uint64_t lockBusy = 0;      // aborted: the fallback lock was held
+    uint64_t conflicts = 0;     // aborted: another core touched our data
+    uint64_t capacity = 0;      // aborted: footprint too large for the cache
+    uint64_t otherAborts = 0;   // interrupts, faults, unfriendly instructions
+
+    uint64_t aborts() const { return lockBusy + conflicts + capacity + otherAborts; }
+};
+
+inline std::ostream& operator<<(std::ostream& out, const ElisionStats& s) {
+    return out << "commits " << s.commits << ", fallbacks " << s.fallbacks
+               << ", aborts " << s.aborts() << " (lock busy " << s.lockBusy
+               << ", conflict " << s.conflicts << ", capacity " << s.capacity
+               << ", other " << s.otherAborts << ")";
+}
+
+// Lock elision over any lock in lock.h. lock() starts an RTM transaction
+// and returns inside it; the critical section then runs speculatively and
+// unlock() commits it, so threads touching disjoint data never serialize.
+// The transaction reads fallbackHeld, so whoever takes the fallback lock
+// aborts every transaction in flight. A transaction that aborts is retried
+// up to Retries times, unless the abort says a retry cannot succeed
+// (capacity, or no retry hint); then the thread takes FallbackLock for
+// real. Without RTM every acquisition goes straight to the fallback lock.
+//
+// Statistics are counted into per-thread padded shards after the
+// transaction has ended, never inside it.
+template <typename FallbackLock = TTASLock, unsigned Retries = 3>
+class ElidedLock : public TimedTryLock<ElidedLock<FallbackLock, Retries>> {
+private:
+    static constexpr unsigned LOCK_BUSY_CODE = 0xff;
+
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        std::atomic<uint64_t> commits{0};
+        std::atomic<uint64_t> fallbacks{0};
+        std::atomic<uint64_t> lockBusy{0};
+        std::atomic<uint64_t> conflicts{0};
+        std::atomic<uint64_t> capacity{0};
+        std::atomic<uint64_t> otherAborts{0};
+    };
+
+    FallbackLock fallback;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> fallbackHeld{false};
+    const bool useRtm;
+    const unsigned numShards;
+    std::unique_ptr<Shard[]> shards;
+
+    static unsigned thread_shard() {
+        static std::atomic<unsigned> nextShard{0};
+        thread_local unsigned shard = nextShard.fetch_add(1, std::memory_order_relaxed);
+        return shard;
+    }
+
+    Shard& my_shard() { return shards[thread_shard() % numShards]; }
+
+    static void bump(std::atomic<uint64_t>& counter) {
+        // relaxed RMW: the shard is normally private, so this never bounces
+        counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Transactions subscribe to fallbackHeld, not to the fallback lock
+    // word, so the flag has to be raised before the holder's first
+    // critical-section access and lowered after its last. seq_cst (xchg on
+    // x86) keeps the critical section below the raise: a transaction that
+    // read the flag false has it in its read set and is aborted by the
+    // store, one that starts later reads true. The release store keeps the
+    // critical section above the clear.
+    void set_held() {
+        fallbackHeld.store(true, std::memory_order_seq_cst);
+        bump(my_shard().fallbacks);
+    }
+
+    void clear_held() { fallbackHeld.store(false, std::memory_order_release); }
+
+    void lock_fallback() {
+        fallback.lock();
+        set_held();
+    }
+
+#if SYNC_HAVE_RTM_INTRINSICS
+    // Returns true once inside a transaction that saw the lock free.
+    SYNC_RTM_TARGET bool try_elide() {
+        for (unsigned attempt = 0; attempt <= Retries; attempt++) {
+            unsigned status = _xbegin();
+            if (status == _XBEGIN_STARTED) {
+                // Puts fallbackHeld in our read set: a fallback holder
+                // arriving later aborts us.
+                if (fallbackHeld.load(std::memory_order_relaxed)) {
+                    _xabort(LOCK_BUSY_CODE);
+                }
+                return true;
+            }
+
+            Shard& shard = my_shard();
+            if ((status & _XABORT_EXPLICIT) && _XABORT_CODE(status) == LOCK_BUSY_CODE) {
+                bump(shard.lockBusy);
+                // Wait for the holder instead of aborting on it again.
+                while (fallbackHeld.load(std::memory_order_relaxed)) {
+                    cpu_relax();
+                }
+                continue;
+            }
+            if (status & _XABORT_CAPACITY) {
+                bump(shard.capacity);
+                return false;
+            }
+            if (status & _XABORT_CONFLICT) {
+                bump(shard.conflicts);
+            } else {
+                bump(shard.otherAborts);
+            }
+            if (!(status & _XABORT_RETRY)) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    SYNC_RTM_TARGET static bool in_transaction() { return _xtest() != 0; }
+
+    SYNC_RTM_TARGET static void commit() { _xend(); }
+#else
+    bool try_elide() { return false; }
+    static bool in_transaction() { return false; }
+    static void commit() {}
+#endif
+
+public:
+    explicit ElidedLock(unsigned numShards = std::max(1u, std::thread::hardware_concurrency()))
+        : useRtm(rtm_supported()), numShards(numShards), shards(new Shard[numShards]) {}
+
+    void lock() {
+        if (useRtm && try_elide()) {
+            return;
+        }
+        lock_fallback();
+    }
+
+    // Elides only while the fallback lock looks free; a holder that takes
+    // it during the attempt can still make the attempt wait for it once.
+    bool try_lock() {
+        if (useRtm && !fallbackHeld.load(std::memory_order_relaxed) && try_elide()) {
+            return true;
+        }
+        if (!fallback.try_lock()) {
+            return false;
+        }
+        set_held();
+        return true;
+    }
+
+    void unlock() {
+        if (useRtm && in_transaction()) {
+            commit();
+            bump(my_shard().commits);
+            return;
+        }
+        clear_held();
+        fallback.unlock();
+    }
+
+    void acquire() { lock(); }
+    void release() { unlock(); }
+
+    // False when every acquisition takes the fallback lock.
+    bool eliding() const { return useRtm; }
+
+    // Sum of the shards: exact once the lock is quiescent.
+    ElisionStats stats() const {
+        ElisionStats s;
+        for (unsigned i = 0; i < numShards; i++) {
+            s.commits += shards[i].commits.load(std::memory_order_relaxed);
+            s.fallbacks += shards[i].fallbacks.load(std::memory_order_relaxed);
+            s.lockBusy += shards[i].lockBusy.load(std::memory_order_relaxed);
+            s.conflicts += shards[i].conflicts.load(std::memory_order_relaxed);
+            s.capacity += shards[i].capacity.load(std::memory_order_relaxed);
+            s.otherAborts += shards[i].otherAborts.load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+};
+
+static_assert(BasicLockable<ElidedLock<>>);
+
+#endif
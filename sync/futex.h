@@ -0,0 +1,37 @@
+#ifndef SYNC_FUTEX_H
+#define SYNC_FUTEX_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+// Thin wrappers over the Linux futex syscall. Elsewhere they degrade to a
+// plain sleep, which keeps the callers portable.
+
+// Sleep until *word != expected, a wake on word, or timeout elapses.
+inline void futex_wait_for(std::atomic<uint32_t>& word, uint32_t expected,
+                           std::chrono::nanoseconds timeout) {
+#if defined(__linux__)
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE,
+            expected, &ts, nullptr, 0);
+#else
+    if (word.load(std::memory_order_relaxed) == expected) {
+        std::this_thread::sleep_for(timeout);
+    }
+#endif
+}
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+#endif
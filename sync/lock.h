@@ -0,0 +1,795 @@
+#ifndef SYNC_LOCK_H
+#define SYNC_LOCK_H
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <concepts>
+#include <memory>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+#include "config.h"
+#include "policy.h"
+#include "park.h"
+#include "topology.h"
+
+// Every lock satisfies BasicLockable (lock/unlock), so it works with
+// std::lock_guard and std::unique_lock. The acquire/release spelling is
+// kept as an alias for the benchmarks.
+template <typename L>
+concept BasicLockable = requires(L& l) {
+    l.lock();
+    l.unlock();
+};
+
+// Every lock is also TimedLockable, like std::timed_mutex, so it works with
+// std::unique_lock's try_to_lock and timeouts. try_lock() gives up rather
+// than wait for a holder, apart from the rare cases CLHLock and ElidedLock
+// document.
+template <typename L>
+concept TimedLockable = BasicLockable<L> && requires(L& l) {
+    { l.try_lock() } -> std::convertible_to<bool>;
+    { l.try_lock_for(std::chrono::microseconds(1)) } -> std::convertible_to<bool>;
+    { l.try_lock_until(std::chrono::steady_clock::now()) } -> std::convertible_to<bool>;
+};
+
+// Pause between two polls of a deadline-bound wait: a pause instruction,
+// and every YieldEvery polls a yield so an oversubscribed holder can run.
+template <unsigned YieldEvery = 64>
+inline void poll_pause(unsigned& polls) {
+    if (++polls % YieldEvery == 0) {
+        std::this_thread::yield();
+    } else {
+        cpu_relax();
+    }
+}
+
+// Retries attempt() until it succeeds or deadline passes; attempt() runs
+// at least once, so an expired deadline still gets one try.
+template <typename Clock, typename Duration, typename Attempt>
+bool poll_until(const std::chrono::time_point<Clock, Duration>& deadline, Attempt attempt) {
+    unsigned polls = 0;
+    while (!attempt()) {
+        if (Clock::now() >= deadline) {
+            return false;
+        }
+        poll_pause(polls);
+    }
+    return true;
+}
+
+// try_lock_for() and try_lock_until() for a lock whose only way to give up
+// waiting is never to start: Derived::try_lock() is polled until the
+// deadline. A timed-out caller leaves nothing behind, but a polling caller
+// is not queued, so a queue lock loses its FIFO order for it;
+// AbortableCLHLock waits in line instead.
+template <typename Derived>
+class TimedTryLock {
+public:
+    template <typename Clock, typename Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& deadline) {
+        return poll_until(deadline, [this]() { return static_cast<Derived*>(this)->try_lock(); });
+    }
+
+    template <typename Rep, typename Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& timeout) {
+        return try_lock_until(std::chrono::steady_clock::now() + timeout);
+    }
+};
+
+// Spin lock assembled from policies: Strategy probes the lock word,
+// BackoffType runs after every failed attempt and Padding aligns the word.
+template <typename Strategy, typename BackoffType = NoBackoff, typename Padding = NoPadding>
+class SpinLock : public TimedTryLock<SpinLock<Strategy, BackoffType, Padding>> {
+private:
+    alignas(Padding::alignment) alignas(std::atomic<bool>) std::atomic<bool> locked{false};
+
+public:
+    void lock() {
+        BackoffType backoff;
+        Strategy::acquire(locked, backoff);
+    }
+
+    bool try_lock() { return Strategy::try_acquire(locked); }
+
+    void unlock() {
+        locked.store(false, std::memory_order_release);
+    }
+
+    void acquire() { lock(); }
+    void release() { unlock(); }
+};
+
+// Backoff used by the *WithBackoff locks.
+using LockBackoff = Backoff<>;
+
+using TASLock = SpinLock<TestAndSet>;
+using TTASLock = SpinLock<TestAndTestAndSet>;
+using TASLockWithBackoff = SpinLock<TestAndSet, LockBackoff>;
+using TTASLockWithBackoff = SpinLock<TestAndTestAndSet, LockBackoff>;
+
+// Ticket lock: FIFO like MCS, but a handoff is a single store to a shared
+// word, so it is cheaper at low thread counts. A waiter that is k tickets
+// away from the front spins about k * SpinsPerWaiter pauses before looking
+// again (proportional backoff), which keeps the serving word from being
+// hammered by threads that cannot be next.
+template <unsigned SpinsPerWaiter = 32, typename Padding = NoPadding>
+class BasicTicketLock : public TimedTryLock<BasicTicketLock<SpinsPerWaiter, Padding>> {
+private:
+    alignas(Padding::alignment) alignas(std::atomic<uint32_t>) std::atomic<uint32_t> next_ticket{0};
+    alignas(Padding::alignment) alignas(std::atomic<uint32_t>) std::atomic<uint32_t> now_serving{0};
+
+public:
+    void lock() {
+        uint32_t ticket = next_ticket.fetch_add(1, std::memory_order_relaxed);
+
+        while (true) {
+            uint32_t serving = now_serving.load(std::memory_order_acquire);
+            if (serving == ticket) {
+                return;
+            }
+
+            // unsigned wrap-around keeps the distance right past 2^32 tickets
+            uint32_t ahead = ticket - serving;
+            for (uint32_t i = 0; i < ahead * SpinsPerWaiter; i++) {
+                cpu_relax();
+            }
+        }
+    }
+
+    // Takes a ticket only if it would be served at once, so a failed try
+    // never joins the line: a ticket cannot be handed back.
+    bool try_lock() {
+        uint32_t serving = now_serving.load(std::memory_order_acquire);
+        uint32_t expected = serving;
+        return next_ticket.compare_exchange_strong(expected, serving + 1, std::memory_order_acquire,
+                                                   std::memory_order_relaxed);
+    }
+
+    void unlock() {
+        // only the holder writes now_serving
+        uint32_t serving = now_serving.load(std::memory_order_relaxed);
+        now_serving.store(serving + 1, std::memory_order_release);
+    }
+
+    void acquire() { lock(); }
+    void release() { unlock(); }
+};
+
+using TicketLock = BasicTicketLock<>;
+
+// Per-thread queue nodes (MCS nodes, CLH handles) for the BasicLockable
+// interface of the queue locks. Every lock a thread holds or is queued on
+// gets its own node, keyed by the lock's address, so a thread can hold
+// several queue locks at once (a lock hierarchy, hand-over-hand) and
+// release them in any order without allocating and without two queues
+// sharing a node. The nodes sit side by side in one thread-local block and
+// take() hands out the lowest free one, so a thread keeps reusing the same
+// few warm lines instead of a new stack slot per acquisition.
+template <typename Node, unsigned Depth = 16>
+class alignas(CACHE_LINE_SIZE) QueueNodeArena {
+private:
+    Node nodes[Depth];
+    const void* heldFor[Depth] = {}; // lock each node is in use for, or null; owner only
+
+public:
+    static QueueNodeArena& mine() {
+        thread_local QueueNodeArena arena;
+        return arena;
+    }
+
+    // A free node, now in use for lock.
+    Node& take(const void* lock) {
+        for (unsigned i = 0; i < Depth; i++) {
+            if (heldFor[i] == nullptr) {
+                heldFor[i] = lock;
+                return nodes[i];
+            }
+        }
+        assert(false && "more queue locks held at once than QueueNodeArena's Depth");
+        std::abort();
+    }
+
+    // The node take(lock) returned.
+    Node& held(const void* lock) {
+        for (unsigned i = Depth; i-- > 0;) {
+            if (heldFor[i] == lock) {
+                return nodes[i];
+            }
+        }
+        assert(false && "unlock() of a queue lock this thread does not hold");
+        std::abort();
+    }
+
+    void give_back(Node& node) { heldFor[&node - nodes] = nullptr; }
+};
+
+// MCS queue lock: each waiter spins on its own node. Park decides whether a
+// waiter that has spun for a while goes to sleep on its node (see park.h).
+template <typename Park = NeverPark>
+class BasicMCSLock : public TimedTryLock<BasicMCSLock<Park>> {
+public:
+    // A line to itself: the waiter spins on it while its predecessor
+    // writes next and its successor's release writes locked.
+    struct alignas(CACHE_LINE_SIZE) Node {
+        std::atomic<Node*> next{nullptr};
+        std::atomic<uint32_t> locked{HANDOFF_WAITING};
+    };
+
+    using NodeArena = QueueNodeArena<Node>;
+
+private:
+    std::atomic<Node*> tail{nullptr};
+    
+public:
+    void lock(Node& myNode) {
+        myNode.next.store(nullptr, std::memory_order_relaxed);
+        myNode.locked.store(HANDOFF_WAITING, std::memory_order_relaxed);
+
+        Node* predecessor = tail.exchange(&myNode, std::memory_order_acq_rel);
+
+        if (predecessor != nullptr) {
+            predecessor->next.store(&myNode, std::memory_order_release);
+            Park::wait(myNode.locked);
+        }
+    }
+
+    // Succeeds only on an empty queue.
+    bool try_lock(Node& myNode) {
+        myNode.next.store(nullptr, std::memory_order_relaxed);
+        myNode.locked.store(HANDOFF_WAITING, std::memory_order_relaxed);
+        Node* expected = nullptr;
+        return tail.compare_exchange_strong(expected, &myNode, std::memory_order_acq_rel,
+                                            std::memory_order_relaxed);
+    }
+
+    void unlock(Node& myNode) {
+        Node* next = myNode.next.load(std::memory_order_acquire);
+        
+        if (next == nullptr) {
+            Node* expected = &myNode;
+            if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release)) {
+                return;
+            }
+            
+            // wait for next node
+            do {
+                std::this_thread::yield();
+                next = myNode.next.load(std::memory_order_acquire);
+            } while (next == nullptr);
+        }
+        
+        // wakes exactly the successor, and only if it parked
+        Park::grant(next->locked);
+    }
+
+    // True if another thread has queued behind myNode. Only meaningful
+    // while myNode holds the lock.
+    bool has_waiters(const Node& myNode) const {
+        return tail.load(std::memory_order_relaxed) != &myNode;
+    }
+
+    // BasicLockable form, queueing on a node from the calling thread's
+    // arena.
+    void lock() { lock(NodeArena::mine().take(this)); }
+
+    bool try_lock() {
+        NodeArena& arena = NodeArena::mine();
+        Node& myNode = arena.take(this);
+        if (try_lock(myNode)) {
+            return true;
+        }
+        arena.give_back(myNode);
+        return false;
+    }
+
+    void unlock() {
+        NodeArena& arena = NodeArena::mine();
+        Node& myNode = arena.held(this);
+        unlock(myNode);
+        arena.give_back(myNode);
+    }
+
+    void acquire() { lock(); }
+    void release() { unlock(); }
+};
+
+using MCSLock = BasicMCSLock<>;
+using ParkingMCSLock = BasicMCSLock<SpinThenPark<>>;
+
+// Holds lock for a scope on a node from the calling thread's arena.
+template <typename LockType = MCSLock>
+class MCSLockGuard {
+private:
+    using Arena = QueueNodeArena<typename LockType::Node>;
+
+    LockType& lock;
+    typename LockType::Node& node;
+
+public:
+    explicit MCSLockGuard(LockType& lock) : lock(lock), node(Arena::mine().take(&lock)) {
+        lock.lock(node);
+    }
+
+    ~MCSLockGuard() {
+        lock.unlock(node);
+        Arena::mine().give_back(node);
+    }
+
+    MCSLockGuard(const MCSLockGuard&) = delete;
+    MCSLockGuard& operator=(const MCSLockGuard&) = delete;
+};
+
+// CLH queue lock: each waiter spins on its predecessor's node. unlock() is
+// a single store to the caller's own node, with no CAS on the tail. On
+// release a thread gives its node to its successor and adopts its
+// predecessor's node for the next acquisition, so nodes move between
+// threads; a Handle owns whichever node it currently holds. Between
+// acquisitions that node is private to the handle, so one handle can queue
+// on any CLH lock, but not on two at once.
+template <typename Park = NeverPark>
+class BasicCLHLock : public TimedTryLock<BasicCLHLock<Park>> {
+private:
+    struct alignas(CACHE_LINE_SIZE) Node {
+        std::atomic<uint32_t> locked{HANDOFF_GRANTED};
+    };
+
+public:
+    class Handle {
+    private:
+        Node* mine = new Node;
+        Node* pred = nullptr;
+
+        friend class BasicCLHLock;
+
+    public:
+        Handle() = default;
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+        ~Handle() { delete mine; }
+    };
+
+private:
+    std::atomic<Node*> tail{new Node};
+
+public:
+    using HandleArena = QueueNodeArena<Handle>;
+
+    BasicCLHLock() = default;
+    BasicCLHLock(const BasicCLHLock&) = delete;
+    BasicCLHLock& operator=(const BasicCLHLock&) = delete;
+
+    // The node left at the tail belongs to the lock.
+    ~BasicCLHLock() { delete tail.load(std::memory_order_relaxed); }
+
+    void lock(Handle& handle) {
+        handle.mine->locked.store(HANDOFF_WAITING, std::memory_order_relaxed);
+        handle.pred = tail.exchange(handle.mine, std::memory_order_acq_rel);
+        Park::wait(handle.pred->locked);
+    }
+
+    // Joins the queue only behind a node that has been released. The tail
+    // can be recycled between the check and the swap (its next owner
+    // re-queues it), so in that rare case the caller is already in line
+    // and waits for one holder rather than leave a hole in the queue.
+    bool try_lock(Handle& handle) {
+        Node* last = tail.load(std::memory_order_acquire);
+        if (last->locked.load(std::memory_order_acquire) != HANDOFF_GRANTED) {
+            return false;
+        }
+        handle.mine->locked.store(HANDOFF_WAITING, std::memory_order_relaxed);
+        if (!tail.compare_exchange_strong(last, handle.mine, std::memory_order_acq_rel,
+                                          std::memory_order_relaxed)) {
+            return false;
+        }
+        handle.pred = last;
+        Park::wait(handle.pred->locked);
+        return true;
+    }
+
+    void unlock(Handle& handle) {
+        Node* released = handle.mine;
+        handle.mine = handle.pred;
+        Park::grant(released->locked);
+    }
+
+    // BasicLockable form, queueing with a handle from the calling thread's
+    // arena, so locks can be nested as with MCSLock.
+    void lock() { lock(HandleArena::mine().take(this)); }
+
+    bool try_lock() {
+        HandleArena& arena = HandleArena::mine();
+        Handle& handle = arena.take(this);
+        if (try_lock(handle)) {
+            return true;
+        }
+        arena.give_back(handle);
+        return false;
+    }
+
+    void unlock() {
+        HandleArena& arena = HandleArena::mine();
+        Handle& handle = arena.held(this);
+        unlock(handle);
+        arena.give_back(handle);
+    }
+
+    void acquire() { lock(); }
+    void release() { unlock(); }
+};
+
+using CLHLock = BasicCLHLock<>;
+
+// CLH lock whose waiters can time out and leave the queue (Scott and
+// Scherer's CLH-try, in the form of Herlihy and Shavit's TOLock). Each
+// waiter spins on its predecessor's node, and a node's pred word tells its
+// successor what to do: null, wait; available(), the lock is yours; any other
+// node, my owner gave up, wait on this one instead. A waiter that times out
+// therefore writes only its own node, and successors skip over abandoned
+// nodes as they find them; one with no successor just takes itself back
+// off the tail.
+//
+// Nodes are not reused by their owner, since a successor may still be
+// reading an abandoned or released one: whoever reads a node last frees it
+// into its own thread's cache. That is the successor that saw available() in
+// it or skipped past it, or the owner if nobody queued behind it. A
+// try_lock() queues and gives up at once, so a free lock is never missed.
+class AbortableCLHLock {
+private:
+    struct alignas(CACHE_LINE_SIZE) Node {
+        std::atomic<Node*> pred{nullptr};
+    };
+
+    // Spare nodes of the calling thread, at most Spares of them.
+    class NodeCache {
+    private:
+        static constexpr size_t Spares = 16;
+        std::vector<Node*> spare;
+
+    public:
+        ~NodeCache() {
+            for (Node* node : spare) {
+                delete node;
+            }
+        }
+
+        Node* get() {
+            if (spare.empty()) {
+                return new Node;
+            }
+            Node* node = spare.back();
+            spare.pop_back();
+            node->pred.store(nullptr, std::memory_order_relaxed);
+            return node;
+        }
+
+        void put(Node* node) {
+            if (spare.size() < Spares) {
+                spare.push_back(node);
+            } else {
+                delete node;
+            }
+        }
+
+        static NodeCache& mine() {
+            thread_local NodeCache cache;
+            return cache;
+        }
+    };
+
+    // The pred of a released node; an address no real node can have.
+    static Node* available() {
+        static Node mark;
+        return &mark;
+    }
+
+    std::atomic<Node*> tail{nullptr};
+    Node* holderNode = nullptr; // written and read by the holder only
+
+    // Waits in line until the lock is ours or expired() says to give up.
+    template <typename Expired>
+    bool wait_in_line(Expired expired) {
+        NodeCache& cache = NodeCache::mine();
+        Node* node = cache.get();
+        Node* pred = tail.exchange(node, std::memory_order_acq_rel);
+
+        unsigned polls = 0;
+        while (pred != nullptr) {
+            Node* predPred = pred->pred.load(std::memory_order_acquire);
+            if (predPred == available()) {
+                cache.put(pred);
+                break;
+            }
+            if (predPred != nullptr) {
+                // pred's owner gave up: wait on its predecessor instead
+                cache.put(pred);
+                pred = predPred;
+                continue;
+            }
+            if (expired()) {
+                Node* expected = node;
+                if (tail.compare_exchange_strong(expected, pred, std::memory_order_acq_rel,
+                                                 std::memory_order_relaxed)) {
+                    cache.put(node); // nobody behind us ever saw it
+                } else {
+                    node->pred.store(pred, std::memory_order_release);
+                }
+                return false;
+            }
+            poll_pause(polls);
+        }
+
+        holderNode = node;
+        return true;
+    }
+
+public:
+    AbortableCLHLock() = default;
+    AbortableCLHLock(const AbortableCLHLock&) = delete;
+    AbortableCLHLock& operator=(const AbortableCLHLock&) = delete;
+
+    // An idle lock can still own a chain from the tail: released and
+    // abandoned nodes nobody queued behind yet.
+    ~AbortableCLHLock() {
+        Node* node = tail.load(std::memory_order_relaxed);
+        while (node != nullptr && node != available()) {
+            Node* pred = node->pred.load(std::memory_order_relaxed);
+            delete node;
+            node = pred;
+        }
+    }
+
+    void lock() {
+        wait_in_line([]() { return false; });
+    }
+
+    bool try_lock() {
+        return wait_in_line([]() { return true; });
+    }
+
+    template <typename Clock, typename Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& deadline) {
+        return wait_in_line([&]() { return Clock::now() >= deadline; });
+    }
+
+    template <typename Rep, typename Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& timeout) {
+        return try_lock_until(std::chrono::steady_clock::now() + timeout);
+    }
+
+    void unlock() {
+        Node* node = holderNode;
+        Node* expected = node;
+        if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+            NodeCache::mine().put(node);
+        } else {
+            node->pred.store(available(), std::memory_order_release);
+        }
+    }
+
+    void acquire() { lock(); }
+    void release() { unlock(); }
+};
+
+// Cohort lock for NUMA machines: threads first queue on an MCS lock local
+// to their NUMA node, and only the head of a node's queue competes for the
+// global lock. A releaser that sees a local waiter passes the global lock
+// along with the local one, so the lock and the data it protects stay on
+// one socket. After HandoffBudget local passes in a row the global lock
+// is released anyway, so other nodes are not starved.
+template <unsigned HandoffBudget = 64, typename GlobalLock = TTASLock>
+class CohortLock : public TimedTryLock<CohortLock<HandoffBudget, GlobalLock>> {
+private:
+    struct alignas(CACHE_LINE_SIZE) Cohort {
+        MCSLock local;
+        // Both are read and written only by the holder of local.
+        bool globalHeld = false;
+        unsigned handoffs = 0;
+    };
+
+    GlobalLock global;
+    std::unique_ptr<Cohort[]> cohorts;
+    const int numCohorts;
+    // Cohort of the current holder; lock() and unlock() may run on
+    // different CPUs if the holder migrates.
+    int holderCohort = 0;
+
+public:
+    CohortLock()
+        : cohorts(new Cohort[NumaTopology::get().node_count()]),
+          numCohorts(NumaTopology::get().node_count()) {}
+
+    void lock(MCSLock::Node& myNode) {
+        int node = std::min(current_numa_node(), numCohorts - 1);
+        Cohort& cohort = cohorts[node];
+
+        cohort.local.lock(myNode);
+        if (!cohort.globalHeld) {
+            global.lock();
+            cohort.globalHeld = true;
+        }
+        holderCohort = node;
+    }
+
+    // An empty local queue means no one in the cohort holds or was handed
+    // the global lock, so it is tried as well.
+    bool try_lock(MCSLock::Node& myNode) {
+        int node = std::min(current_numa_node(), numCohorts - 1);
+        Cohort& cohort = cohorts[node];
+
+        if (!cohort.local.try_lock(myNode)) {
+            return false;
+        }
+        if (!cohort.globalHeld) {
+            if (!global.try_lock()) {
+                cohort.local.unlock(myNode);
+                return false;
+            }
+            cohort.globalHeld = true;
+        }
+        holderCohort = node;
+        return true;
+    }
+
+    void unlock(MCSLock::Node& myNode) {
+        Cohort& cohort = cohorts[holderCohort];
+
+        if (cohort.handoffs < HandoffBudget && cohort.local.has_waiters(myNode)) {
+            // keep the global lock inside this node
+            cohort.handoffs++;
+        } else {
+            cohort.handoffs = 0;
+            cohort.globalHeld = false;
+            global.unlock();
+        }
+        cohort.local.unlock(myNode);
+    }
+
+    // BasicLockable form, queueing on a node from the calling thread's
+    // arena.
+    void lock() { lock(MCSLock::NodeArena::mine().take(this)); }
+
+    bool try_lock() {
+        MCSLock::NodeArena& arena = MCSLock::NodeArena::mine();
+        MCSLock::Node& myNode = arena.take(this);
+        if (try_lock(myNode)) {
+            return true;
+        }
+        arena.give_back(myNode);
+        return false;
+    }
+
+    void unlock() {
+        MCSLock::NodeArena& arena = MCSLock::NodeArena::mine();
+        MCSLock::Node& myNode = arena.held(this);
+        unlock(myNode);
+        arena.give_back(myNode);
+    }
+
+    void acquire() { lock(); }
+    void release() { unlock(); }
+};
+
+// Lock that adapts to its own contention. Mutual exclusion always comes
+// from one test-and-test-and-set word; the mode only decides how a thread
+// waits for its turn to probe it, so switching modes can never let two
+// threads in. In spin mode every waiter probes the word directly, which is
+// cheapest at one or two threads. In queue mode waiters first line up on
+// an MCS lock and only its head probes the word, so at most two threads
+// share the word's line however many are waiting, as with MCSLock. The
+// holder keeps a moving average (out of 256) of how many acquisitions were
+// contended: the new holder had to wait, or other threads were still
+// waiting when it got the lock (counted by spinners, which a waiter joins
+// after its first failed probe, or an MCS successor queued behind it).
+// Above QueueAbove the lock switches to queue mode, below SpinBelow back
+// to spin mode.
+template <unsigned QueueAbove = 128, unsigned SpinBelow = 32, typename BackoffType = LockBackoff>
+class BasicAdaptiveLock : public TimedTryLock<BasicAdaptiveLock<QueueAbove, SpinBelow, BackoffType>> {
+private:
+    static constexpr unsigned CONTENTION_SCALE = 256;
+    static_assert(SpinBelow < QueueAbove && QueueAbove < CONTENTION_SCALE);
+
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> locked{false};
+    std::atomic<bool> queueMode{false};
+    unsigned contention = 0; // written by the holder only
+    alignas(CACHE_LINE_SIZE) std::atomic<unsigned> spinners{0};
+    alignas(CACHE_LINE_SIZE) MCSLock queue;
+
+    // Takes the word; returns true if it was contended.
+    bool take_word() {
+        if (!locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire)) {
+            return spinners.load(std::memory_order_relaxed) != 0;
+        }
+
+        spinners.fetch_add(1, std::memory_order_relaxed);
+        BackoffType backoff;
+        while (true) {
+            while (locked.load(std::memory_order_relaxed)) {
+                backoff();
+            }
+            if (!locked.exchange(true, std::memory_order_acquire)) {
+                break;
+            }
+        }
+        spinners.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Called by the new holder, so every access is ordered by the word.
+    void record(bool contended) {
+        contention = contention - contention / 8 + (contended ? CONTENTION_SCALE / 8 : 0);
+        bool queueing = queueMode.load(std::memory_order_relaxed);
+        if (!queueing && contention > QueueAbove) {
+            queueMode.store(true, std::memory_order_relaxed);
+        } else if (queueing && contention < SpinBelow) {
+            queueMode.store(false, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    void lock() {
+        if (!queueMode.load(std::memory_order_relaxed)) {
+            record(take_word());
+            return;
+        }
+
+        // The caller may already hold other MCS locks; the arena gives
+        // this queue a node of its own.
+        MCSLock::NodeArena& arena = MCSLock::NodeArena::mine();
+        MCSLock::Node& node = arena.take(&queue);
+        queue.lock(node);
+        bool contended = take_word();
+        contended = queue.has_waiters(node) || contended;
+        queue.unlock(node);
+        arena.give_back(node);
+        record(contended);
+    }
+
+    // One probe of the word in either mode; in queue mode that passes the
+    // queue, as any try must.
+    bool try_lock() {
+        if (locked.load(std::memory_order_relaxed) || locked.exchange(true, std::memory_order_acquire)) {
+            return false;
+        }
+        record(spinners.load(std::memory_order_relaxed) != 0);
+        return true;
+    }
+
+    void unlock() {
+        locked.store(false, std::memory_order_release);
+    }
+
+    // Current mode, for tests and reporting.
+    bool queueing() const { return queueMode.load(std::memory_order_relaxed); }
+
+    void acquire() { lock(); }
+    void release() { unlock(); }
+};
+
+using AdaptiveLock = BasicAdaptiveLock<>;
+
+static_assert(BasicLockable<TASLock>);
+static_assert(BasicLockable<TTASLock>);
+static_assert(BasicLockable<MCSLock>);
+static_assert(BasicLockable<ParkingMCSLock>);
+static_assert(BasicLockable<TicketLock>);
+static_assert(BasicLockable<CLHLock>);
+static_assert(BasicLockable<CohortLock<>>);
+static_assert(BasicLockable<AdaptiveLock>);
+static_assert(BasicLockable<AbortableCLHLock>);
+
+static_assert(TimedLockable<TASLock>);
+static_assert(TimedLockable<TTASLockWithBackoff>);
+static_assert(TimedLockable<TicketLock>);
+static_assert(TimedLockable<MCSLock>);
+static_assert(TimedLockable<ParkingMCSLock>);
+static_assert(TimedLockable<CLHLock>);
+static_assert(TimedLockable<AbortableCLHLock>);
+static_assert(TimedLockable<CohortLock<>>);
+static_assert(TimedLockable<AdaptiveLock>);
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef SYNC_PARALLEL_H
+#define SYNC_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "config.h"
+#include "backoff.h"
+#include "pool.h"
+
+// Bulk-synchronous loops on a WorkerPool: parallel_for runs body(i) for
+// every index of a range, parallel_reduce also folds the results. Both
+// return only when every index is done, like a loop followed by a barrier.
+//
+//     WorkerPool pool(threads, placement_cpus(placement, threads));
+//     parallel_for(pool, {0, n}, 0, [&](int64_t i) { y[i] += a * x[i]; });
+//     double sum = parallel_reduce(pool, {0, n}, 1024, 0.0,
+//                                  [&](int64_t i) { return x[i] * y[i]; },
+//                                  [](double a, double b) { return a + b; },
+//                                  Schedule::Dynamic);
+
+// How indices are split into chunks and handed to workers.
+enum class Schedule {
+    Static,  // fixed chunks of grain dealt round-robin; no shared state
+    Dynamic, // next chunk of grain claimed with fetch_add on a shared index
+    Guided,  // like Dynamic, but each chunk is the remaining work over twice
+             // the workers, shrinking to grain: few claims, balanced tail
+};
+
+inline const char* schedule_name(Schedule schedule) {
+    switch (schedule) {
+    case Schedule::Static: return "static";
+    case Schedule::Dynamic: return "dynamic";
+    case Schedule::Guided: return "guided";
+    }
+    return "?";
+}
+
+// Half-open [begin, end).
+struct IndexRange {
+    int64_t begin = 0;
+    int64_t end = 0;
+
+    int64_t size() const { return std::max<int64_t>(end - begin, 0); }
+};
+
+// Hands out one loop's chunks. grain <= 0 picks a default: one contiguous
+// block per worker under Static, and an eighth of that under Dynamic and
+// Guided.
+class LoopChunks {
+private:
+    const IndexRange range;
+    const Schedule schedule;
+    const int workers;
+    const int64_t grain;
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> next;
+
+    static int64_t default_grain(int64_t size, int workers, Schedule schedule) {
+        int64_t block = (size + workers - 1) / workers;
+        return std::max<int64_t>(1, schedule == Schedule::Static ? block : block / 8);
+    }
+
+public:
+    LoopChunks(IndexRange range, int64_t grain, Schedule schedule, int workers)
+        : range(range), schedule(schedule), workers(workers),
+          grain(grain > 0 ? grain : default_grain(range.size(), workers, schedule)), next(range.begin) {}
+
+    // Calls chunk(first, last) for each chunk worker gets, until none are
+    // left.
+    template <typename F>
+    void for_each(int worker, F&& chunk) {
+        if (schedule == Schedule::Static) {
+            int64_t stride = grain * workers;
+            for (int64_t first = range.begin + grain * worker; first < range.end; first += stride) {
+                chunk(first, std::min(first + grain, range.end));
+            }
+        } else if (schedule == Schedule::Dynamic) {
+            while (true) {
+                int64_t first = next.fetch_add(grain, std::memory_order_relaxed);
+                if (first >= range.end) {
+                    return;
+                }
+                chunk(first, std::min(first + grain, range.end));
+            }
+        } else {
+            int64_t first = next.load(std::memory_order_relaxed);
+            while (first < range.end) {
+                int64_t size = std::max(grain, (range.end - first) / (2 * workers));
+                if (next.compare_exchange_weak(first, first + size, std::memory_order_relaxed)) {
+                    chunk(first, std::min(first + size, range.end));
+                    first = next.load(std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+};
+
+// Runs body(i) for every i in range on every worker of pool.
+template <typename Body>
+void parallel_for(WorkerPool& pool, IndexRange range, int64_t grain, Body body,
+                  Schedule schedule = Schedule::Static) {
+    LoopChunks chunks(range, grain, schedule, pool.size());
+    pool.run([&](int worker) {
+        chunks.for_each(worker, [&](int64_t first, int64_t last) {
+            for (int64_t i = first; i < last; i++) {
+                body(i);
+            }
+        });
+    });
+}
+
+// Folds body(i) over range with combine, starting every worker from
+// identity. Each worker accumulates into its own cache line; the partials
+// are then combined up a binary tree, worker w taking w + 2^k's in round
+// k, so no shared word is written per index and the combine is log2(workers)
+// steps deep. combine must be associative, and commutative as well unless
+// each worker gets one contiguous block (Static with the default grain):
+// under Dynamic and Guided chunks land on workers in any order, and under
+// Static with a smaller grain each worker folds every workers-th chunk, so
+// either way the partials cover interleaved index ranges.
+template <typename T, typename Body, typename Combine>
+T parallel_reduce(WorkerPool& pool, IndexRange range, int64_t grain, T identity, Body body, Combine combine,
+                  Schedule schedule = Schedule::Static) {
+    struct alignas(CACHE_LINE_SIZE) Partial {
+        T value;
+        std::atomic<bool> ready{false};
+    };
+
+    const int workers = pool.size();
+    std::unique_ptr<Partial[]> partials(new Partial[workers]);
+    LoopChunks chunks(range, grain, schedule, workers);
+
+    pool.run([&](int worker) {
+        T mine = identity;
+        chunks.for_each(worker, [&](int64_t first, int64_t last) {
+            for (int64_t i = first; i < last; i++) {
+                mine = combine(mine, body(i));
+            }
+        });
+
+        for (int step = 1; step < workers && (worker & step) == 0; step *= 2) {
+            if (worker + step < workers) {
+                Partial& partner = partials[worker + step];
+                Backoff<> backoff;
+                while (!partner.ready.load(std::memory_order_acquire)) {
+                    backoff();
+                }
+                mine = combine(mine, partner.value);
+            }
+        }
+        partials[worker].value = mine;
+        partials[worker].ready.store(true, std::memory_order_release);
+    });
+
+    return workers > 0 ? partials[0].value : identity;
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef SYNC_PARK_H
+#define SYNC_PARK_H
+
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include "config.h"
+
+// Parking policies: how a queued waiter waits for its handoff word.
+//
+// A handoff word starts at HANDOFF_WAITING and is set to HANDOFF_GRANTED by
+// the releasing thread. A parked waiter first moves it to HANDOFF_PARKED,
+// which tells the releaser that a wake-up is owed; waiters that are still
+// spinning cost the releaser nothing but a store.
+
+enum : uint32_t {
+    HANDOFF_GRANTED = 0,
+    HANDOFF_WAITING = 1,
+    HANDOFF_PARKED = 2,
+};
+
+// Spin forever, yielding between polls.
+struct NeverPark {
+    static constexpr bool parks = false;
+
+    static void wait(std::atomic<uint32_t>& word) {
+        while (word.load(std::memory_order_acquire) != HANDOFF_GRANTED) {
+            std::this_thread::yield();
+        }
+    }
+
+    static void grant(std::atomic<uint32_t>& word) {
+        word.store(HANDOFF_GRANTED, std::memory_order_release);
+    }
+};
+
+// Poll up to SpinLimit times, yield up to YieldLimit times, then sleep on
+// the word (futex on Linux) until the releaser hands over. Under
+// oversubscription this gives the core back to the lock holder instead of
+// burning it.
+template <unsigned SpinLimit = 128, unsigned YieldLimit = 8>
+struct SpinThenPark {
+    static constexpr bool parks = true;
+    static constexpr unsigned spin_limit = SpinLimit;
+    static constexpr unsigned yield_limit = YieldLimit;
+
+    static void wait(std::atomic<uint32_t>& word) {
+        for (unsigned i = 0; i < SpinLimit + YieldLimit; i++) {
+            if (word.load(std::memory_order_acquire) == HANDOFF_GRANTED) {
+                return;
+            }
+            if (i < SpinLimit) {
+                cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+
+        uint32_t expected = HANDOFF_WAITING;
+        if (!word.compare_exchange_strong(expected, HANDOFF_PARKED, std::memory_order_acquire)) {
+            return; // granted while we were deciding to park
+        }
+
+        while (word.load(std::memory_order_acquire) == HANDOFF_PARKED) {
+            word.wait(HANDOFF_PARKED, std::memory_order_acquire);
+        }
+    }
+
+    static void grant(std::atomic<uint32_t>& word) {
+        // The waiter may return as soon as it sees GRANTED, so the wake-up
+        // can reach a word that has already been reused. A futex wake on a
+        // live address is at worst a spurious wake-up, which waiters absorb.
+        if (word.exchange(HANDOFF_GRANTED, std::memory_order_release) == HANDOFF_PARKED) {
+            word.notify_one();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef SYNC_POLICY_H
+#define SYNC_POLICY_H
+
+#include <atomic>
+#include <cstddef>
+#include "config.h"
+#include "backoff.h"
+
+// Compile-time policies shared by the locks, barriers and counters.
+// Every primitive takes them as template parameters, so picking a
+// different combination costs nothing at run time.
+
+// ---------------------------------------------------------------------------
+// Spin strategies: how a spin lock probes its lock word, until it is ours
+// (acquire) or once (try_acquire).
+// ---------------------------------------------------------------------------
+
+// Hammer the word with exchange until it is ours.
+struct TestAndSet {
+    template <typename BackoffType>
+    static void acquire(std::atomic<bool>& locked, BackoffType& backoff) {
+        while (locked.exchange(true, std::memory_order_acquire)) {
+            backoff();
+        }
+    }
+
+    static bool try_acquire(std::atomic<bool>& locked) {
+        return !locked.exchange(true, std::memory_order_acquire);
+    }
+};
+
+// Spin on a plain load until the word looks free, then try the exchange.
+struct TestAndTestAndSet {
+    template <typename BackoffType>
+    static void acquire(std::atomic<bool>& locked, BackoffType& backoff) {
+        while (true) {
+            while (locked.load(std::memory_order_relaxed)) {
+                // wait
+            }
+
+            // test-and-set
+            if (!locked.exchange(true, std::memory_order_acquire)) {
+                return;
+            }
+
+            backoff();
+        }
+    }
+
+    static bool try_acquire(std::atomic<bool>& locked) {
+        return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire);
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Padding policies: alignment applied to a primitive's hot words.
+// ---------------------------------------------------------------------------
+
+// Natural alignment; the primitive is as small as possible.
+struct NoPadding {
+    static constexpr std::size_t alignment = 1;
+};
+
+// Hot words get a cache line to themselves, so arrays of primitives or a
+// primitive next to hot data do not false-share.
+struct CacheLinePadding {
+    static constexpr std::size_t alignment = CACHE_LINE_SIZE;
+};
+
+// Two lines. Intel's spatial prefetcher fetches lines in 128-byte aligned
+// pairs, so words one line apart can still interfere there.
+struct AdjacentLinePadding {
+    static constexpr std::size_t alignment = 2 * CACHE_LINE_SIZE;
+};
+
+// Any object, lock or counter alone in a Padding::alignment block, for
+// primitives that have no Padding parameter of their own or when the
+// whole object rather than its hot words should be isolated:
+//     Padded<MCSLock> locks[16];
+//     locks[i].value.lock();
+template <typename T, typename Padding = CacheLinePadding>
+struct alignas(Padding::alignment) alignas(T) Padded {
+    T value;
+};
+
+// ---------------------------------------------------------------------------
+// Memory-ordering policies: how strongly the counters and the sense-reversing
+// barrier order their atomics. On x86 every RMW is a full fence whatever is
+// asked for, so the choice only changes seq_cst stores (xchg instead of a
+// plain mov). On ARM seq_cst loads and stores are ldar / stlr, RMWs are
+// acquire-release, and a strong CAS needs a loop of its own around the
+// exclusive pair, so the minimal orders save more there. With
+// -march=armv8.1-a or later (LSE) an RMW is a single ldadd / cas of exactly
+// the order asked for.
+// ---------------------------------------------------------------------------
+
+// seq_cst everywhere and compare_exchange_strong: every access is ordered
+// against every other, whatever the primitive needs. (Each constant names
+// the order an access needs; the policy says which one it gets.)
+struct SequentialOrdering {
+    static constexpr std::memory_order relaxed = std::memory_order_seq_cst;
+    static constexpr std::memory_order acquire = std::memory_order_seq_cst;
+    static constexpr std::memory_order release = std::memory_order_seq_cst;
+
+    // Gives a preceding release RMW acquire semantics as well; a seq_cst
+    // RMW already has them.
+    static void acquire_fence() {}
+
+    template <typename T>
+    static bool compare_exchange(std::atomic<T>& word, T& expected, T desired, std::memory_order order) {
+        return word.compare_exchange_strong(expected, desired, order);
+    }
+};
+
+// The weakest orders the primitive is correct with, and
+// compare_exchange_weak in retry loops: a spurious failure just costs one
+// more trip round the loop the caller already has, where strong would hide
+// a second loop inside.
+struct MinimalOrdering {
+    static constexpr std::memory_order relaxed = std::memory_order_relaxed;
+    static constexpr std::memory_order acquire = std::memory_order_acquire;
+    static constexpr std::memory_order release = std::memory_order_release;
+
+    static void acquire_fence() {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+
+    template <typename T>
+    static bool compare_exchange(std::atomic<T>& word, T& expected, T desired, std::memory_order order) {
+        return word.compare_exchange_weak(expected, desired, order);
+    }
+};
+
+#endif
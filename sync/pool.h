@@ -0,0 +1,193 @@
+#ifndef SYNC_POOL_H
+#define SYNC_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "config.h"
+#include "topology.h"
+#include "barrier.h"
+#include "queue.h"
+
+// A fixed set of persistent worker threads, each pinned once when the pool
+// is built, driven fork-join style through a barrier shared with the
+// calling thread:
+//
+//     WorkerPool pool(threads, placement_cpus(placement, threads));
+//     pool.run([&](int worker) { ... });           // every worker, then join
+//     double s = pool.run_timed([&](int worker) { ... });
+//     pool.run_tasks(count, [&](int64_t task) { ... });
+//
+// A fork is one barrier episode and a join another, so reusing the pool
+// costs two barrier waits instead of creating and joining threads. Idle
+// workers sit in the fork barrier; with the default parking barrier they
+// sleep there rather than spin between jobs.
+//
+// Only one thread may drive a pool at a time, and the job must not throw.
+template <typename BarrierType = ParkingSenseReversingBarrier>
+class BasicWorkerPool {
+private:
+    struct alignas(CACHE_LINE_SIZE) WorkerState {
+        std::chrono::steady_clock::time_point finished;
+        std::unique_ptr<WorkStealingDeque<int64_t>> tasks;
+    };
+
+    const int numWorkers;
+    const std::vector<int> workerCpus;
+    BarrierType phase;                    // workers + the caller
+    SenseReversingBarrier lineup;         // workers only, spinning, for timed starts
+    std::unique_ptr<WorkerState[]> state;
+    std::vector<std::thread> workers;
+
+    // The job of the current fork, type-erased as in DelegationLock.
+    void (*invoke)(void*, int) = nullptr;
+    void* closure = nullptr;
+    bool stopping = false;
+
+    void work(int worker) {
+        if (!workerCpus.empty()) {
+            pin_current_thread(workerCpus[worker % workerCpus.size()]);
+        }
+        while (true) {
+            phase.wait();   // fork: the barrier publishes invoke, closure and stopping
+            if (stopping) {
+                return;
+            }
+            invoke(closure, worker);
+            phase.wait();   // join
+        }
+    }
+
+    // Takes the next task: the worker's own newest, else the oldest of
+    // another worker's. False once every deque is empty; nothing is pushed
+    // during a run, so that is final.
+    bool next_task(int worker, int64_t& task) {
+        if (state[worker].tasks->pop(task)) {
+            return true;
+        }
+        while (true) {
+            bool anyLeft = false;
+            for (int i = 1; i < numWorkers; i++) {
+                WorkStealingDeque<int64_t>& victim = *state[(worker + i) % numWorkers].tasks;
+                if (victim.steal(task)) {
+                    return true;
+                }
+                anyLeft = anyLeft || !victim.empty();
+            }
+            if (!anyLeft) {
+                return false;
+            }
+            cpu_relax(); // lost every race this sweep
+        }
+    }
+
+public:
+    // Starts numWorkers threads; worker i is pinned to cpus[i % cpus.size()]
+    // unless cpus is empty.
+    explicit BasicWorkerPool(int numWorkers, std::vector<int> cpus = {})
+        : numWorkers(numWorkers), workerCpus(std::move(cpus)), phase(numWorkers + 1), lineup(numWorkers),
+          state(new WorkerState[numWorkers]) {
+        for (int i = 0; i < numWorkers; i++) {
+            state[i].tasks = std::make_unique<WorkStealingDeque<int64_t>>(64);
+        }
+        for (int i = 0; i < numWorkers; i++) {
+            workers.emplace_back([this, i]() { work(i); });
+        }
+    }
+
+    BasicWorkerPool(const BasicWorkerPool&) = delete;
+    BasicWorkerPool& operator=(const BasicWorkerPool&) = delete;
+
+    ~BasicWorkerPool() {
+        stopping = true;
+        phase.wait();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    int size() const { return numWorkers; }
+    const std::vector<int>& cpus() const { return workerCpus; }
+
+    // Forks job(worker) onto every worker and returns at once; the caller
+    // may do its own work until join(). job must outlive the join.
+    template <typename F>
+    void fork(F& job) {
+        invoke = [](void* f, int worker) { (*static_cast<F*>(f))(worker); };
+        closure = &job;
+        phase.wait();
+    }
+
+    // Waits for every worker to finish the forked job.
+    void join() { phase.wait(); }
+
+    template <typename F>
+    void run(F&& job) {
+        fork(job);
+        join();
+    }
+
+    // Runs job(worker) on every worker and returns the seconds from the
+    // moment all of them were lined up and released together until the last
+    // one finished. Thread start-up, wake-up from the fork and the join are
+    // outside the timed region. during() runs on the caller while the job
+    // does, e.g. to end a timed run.
+    template <typename F, typename During>
+    double run_timed(F&& job, During during) {
+        std::chrono::steady_clock::time_point started;
+        auto timed = [&](int worker) {
+            lineup.wait();
+            if (worker == 0) {
+                started = std::chrono::steady_clock::now();
+            }
+            job(worker);
+            state[worker].finished = std::chrono::steady_clock::now();
+        };
+        fork(timed);
+        during();
+        join();
+
+        auto finished = started;
+        for (int i = 0; i < numWorkers; i++) {
+            finished = std::max(finished, state[i].finished);
+        }
+        return std::chrono::duration<double>(finished - started).count();
+    }
+
+    template <typename F>
+    double run_timed(F&& job) {
+        return run_timed(job, []() {});
+    }
+
+    // Runs task(i) once for every i in [0, count), spread over the workers
+    // by work stealing. Each worker starts with a contiguous block, which
+    // it runs front to back; a worker that runs out steals from the far
+    // end of another's block. Tasks should be coarse: each one costs a
+    // deque operation.
+    template <typename F>
+    void run_tasks(int64_t count, F&& task) {
+        // Filled here, before the fork hands each deque to its owner.
+        for (int w = 0; w < numWorkers; w++) {
+            int64_t begin = count * w / numWorkers;
+            int64_t end = count * (w + 1) / numWorkers;
+            for (int64_t i = end - 1; i >= begin; i--) {
+                state[w].tasks->push(i);
+            }
+        }
+        run([&](int worker) {
+            int64_t i;
+            while (next_task(worker, i)) {
+                task(i);
+            }
+        });
+    }
+};
+
+using WorkerPool = BasicWorkerPool<>;
+
+#endif
@@ -0,0 +1,312 @@
+#ifndef SYNC_PROFILE_H
+#define SYNC_PROFILE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "config.h"
+#include "clock.h"
+#include "lock.h"
+
+// Contention profiling for any lock in lock.h. Wrap the lock:
+//
+//     ProfiledLock<MCSLock> accountsLock("accounts");
+//     ...
+//     dump_lock_profiles(std::cerr);   // every live profiled lock, hottest first
+//
+// ProfiledLock<L, false> is a plain forwarding wrapper with no state and
+// no work, so the profiling can be compiled out by flipping one template
+// argument at the declaration.
+
+// Spin rounds run by this thread, summed over every lock. CountingBackoff
+// adds to it; ProfiledLock reads it before and after an acquisition.
+inline thread_local uint64_t lockSpinRounds = 0;
+
+// Backoff that counts its rounds into lockSpinRounds, so a spin lock built
+// with it reports spins through ProfiledLock. Locks that do not spin
+// through a backoff (ticket, queue locks) report wait time only.
+template <typename Inner = LockBackoff>
+class CountingBackoff {
+private:
+    Inner inner;
+
+public:
+    void operator()() {
+        lockSpinRounds++;
+        inner();
+    }
+};
+
+// Totals for one lock. Times are in read_ticks() units.
+struct LockProfile {
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;     // lock was held or queued for when the caller arrived
+    uint64_t failedTries = 0;   // try_lock() calls that found the lock taken
+    uint64_t spins = 0;
+    uint64_t waitTicks = 0;     // from calling lock() until it returned
+    uint64_t holdTicks = 0;     // from lock() returning until unlock()
+
+    static double ns(uint64_t ticks) { return ticks * ns_per_tick(); }
+
+    double contended_fraction() const { return acquisitions ? double(contended) / acquisitions : 0; }
+    double mean_wait_ns() const { return acquisitions ? ns(waitTicks) / acquisitions : 0; }
+    double mean_hold_ns() const { return acquisitions ? ns(holdTicks) / acquisitions : 0; }
+};
+
+inline void print_lock_profile(std::ostream& out, const std::string& name, const LockProfile& p) {
+    out << std::left << std::setw(24) << (name.empty() ? "(unnamed)" : name)
+        << " acquisitions " << p.acquisitions
+        << ", contended " << std::fixed << std::setprecision(1) << 100 * p.contended_fraction() << "%"
+        << ", failed tries " << p.failedTries
+        << ", spins " << p.spins
+        << ", wait " << std::setprecision(0) << LockProfile::ns(p.waitTicks) / 1e3 << "us"
+        << " (mean " << p.mean_wait_ns() << "ns)"
+        << ", hold " << LockProfile::ns(p.holdTicks) / 1e3 << "us"
+        << " (mean " << p.mean_hold_ns() << "ns)" << std::defaultfloat << "\n";
+}
+
+// Every live enabled ProfiledLock, so a process can dump all of them
+// without knowing where they are.
+class LockProfileRegistry {
+public:
+    struct Entry {
+        const void* lock;
+        std::string (*name)(const void*);
+        LockProfile (*snapshot)(const void*);
+    };
+
+private:
+    std::mutex mutex;
+    std::vector<Entry> entries;
+
+public:
+    static LockProfileRegistry& get() {
+        static LockProfileRegistry registry;
+        return registry;
+    }
+
+    void add(const Entry& entry) {
+        std::lock_guard<std::mutex> guard(mutex);
+        entries.push_back(entry);
+    }
+
+    void remove(const void* lock) {
+        std::lock_guard<std::mutex> guard(mutex);
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                     [lock](const Entry& e) { return e.lock == lock; }),
+                      entries.end());
+    }
+
+    // Names and totals of every registered lock, most total wait first.
+    std::vector<std::pair<std::string, LockProfile>> collect() {
+        std::vector<std::pair<std::string, LockProfile>> profiles;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            for (const Entry& e : entries) {
+                profiles.emplace_back(e.name(e.lock), e.snapshot(e.lock));
+            }
+        }
+        std::sort(profiles.begin(), profiles.end(), [](const auto& a, const auto& b) {
+            return a.second.waitTicks > b.second.waitTicks;
+        });
+        return profiles;
+    }
+};
+
+inline void dump_lock_profiles(std::ostream& out) {
+    for (const auto& [name, profile] : LockProfileRegistry::get().collect()) {
+        print_lock_profile(out, name, profile);
+    }
+}
+
+// Exposes L::Node when L has one, so MCSLockGuard<ProfiledLock<MCSLock>>
+// and the Node-taking lock()/unlock() overloads work as for the bare lock.
+template <typename L>
+struct ProfiledNode {};
+
+template <typename L>
+    requires requires { typename L::Node; }
+struct ProfiledNode<L> {
+    using Node = typename L::Node;
+};
+
+template <typename LockType, bool Enabled = true>
+class ProfiledLock;
+
+// Disabled: forwards to the lock and records nothing.
+template <typename LockType>
+class ProfiledLock<LockType, false> : public ProfiledNode<LockType>,
+                                      public TimedTryLock<ProfiledLock<LockType, false>> {
+private:
+    LockType inner;
+
+public:
+    explicit ProfiledLock(const std::string& = "") {}
+
+    void lock() { inner.lock(); }
+    bool try_lock() { return inner.try_lock(); }
+    void unlock() { inner.unlock(); }
+
+    template <typename NodeType>
+    void lock(NodeType& node) { inner.lock(node); }
+    template <typename NodeType>
+    void unlock(NodeType& node) { inner.unlock(node); }
+
+    void acquire() { lock(); }
+    void release() { unlock(); }
+
+    LockProfile snapshot() const { return {}; }
+    void dump(std::ostream&) const {}
+};
+
+// Enabled: counts into per-thread padded shards, so the bookkeeping of
+// threads acquiring the same lock never shares a cache line. Contention is
+// detected by counting callers present: one that arrives while the count
+// is nonzero found the lock held or other callers waiting. Callers leave
+// the count when they release the lock or when their try_lock() fails.
+// That costs one relaxed RMW on arrival and one on departure, on a line of
+// its own; the acquisition timestamp is written by the holder.
+template <typename LockType>
+class ProfiledLock<LockType, true> : public ProfiledNode<LockType>,
+                                     public TimedTryLock<ProfiledLock<LockType, true>> {
+private:
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        std::atomic<uint64_t> acquisitions{0};
+        std::atomic<uint64_t> contended{0};
+        std::atomic<uint64_t> failedTries{0};
+        std::atomic<uint64_t> spins{0};
+        std::atomic<uint64_t> waitTicks{0};
+        std::atomic<uint64_t> holdTicks{0};
+    };
+
+    LockType inner;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> present{0};
+    uint64_t acquiredAt = 0;
+    const std::string name;
+    const unsigned numShards;
+    std::unique_ptr<Shard[]> shards;
+
+    static unsigned thread_shard() {
+        static std::atomic<unsigned> nextShard{0};
+        thread_local unsigned shard = nextShard.fetch_add(1, std::memory_order_relaxed);
+        return shard;
+    }
+
+    // Reports whether anyone was holding or waiting for the lock.
+    bool arrive() { return present.fetch_add(1, std::memory_order_relaxed) != 0; }
+
+    void depart() { present.fetch_sub(1, std::memory_order_relaxed); }
+
+    template <typename Acquire>
+    void profiled_lock(Acquire acquire) {
+        bool wasHeld = arrive();
+        uint64_t spinsBefore = lockSpinRounds;
+        uint64_t requested = read_ticks();
+        acquire();
+        acquired(wasHeld, lockSpinRounds - spinsBefore, requested);
+    }
+
+    // Called by the new holder.
+    void acquired(bool wasHeld, uint64_t spins, uint64_t requested) {
+        uint64_t now = read_ticks();
+
+        // relaxed RMW: the shard is normally private, so this never bounces
+        Shard& s = shards[thread_shard() % numShards];
+        s.acquisitions.fetch_add(1, std::memory_order_relaxed);
+        s.contended.fetch_add(wasHeld, std::memory_order_relaxed);
+        s.spins.fetch_add(spins, std::memory_order_relaxed);
+        s.waitTicks.fetch_add(now - requested, std::memory_order_relaxed);
+
+        acquiredAt = now;
+    }
+
+    template <typename Release>
+    void profiled_unlock(Release release) {
+        shards[thread_shard() % numShards].holdTicks.fetch_add(read_ticks() - acquiredAt,
+                                                               std::memory_order_relaxed);
+        depart();
+        release();
+    }
+
+public:
+    explicit ProfiledLock(const std::string& name = "",
+                          unsigned numShards = std::max(1u, std::thread::hardware_concurrency()))
+        : name(name), numShards(numShards), shards(new Shard[numShards]) {
+        LockProfileRegistry::get().add({
+            this,
+            [](const void* self) { return static_cast<const ProfiledLock*>(self)->name; },
+            [](const void* self) { return static_cast<const ProfiledLock*>(self)->snapshot(); },
+        });
+    }
+
+    ProfiledLock(const ProfiledLock&) = delete;
+    ProfiledLock& operator=(const ProfiledLock&) = delete;
+
+    ~ProfiledLock() { LockProfileRegistry::get().remove(this); }
+
+    void lock() {
+        profiled_lock([this]() { inner.lock(); });
+    }
+
+    // Arrives like lock(), so a lock() racing with it sees it as
+    // contention. A try that fails departs at once and is counted in
+    // failedTries.
+    bool try_lock() {
+        bool wasHeld = arrive();
+        uint64_t requested = read_ticks();
+        if (!inner.try_lock()) {
+            depart();
+            shards[thread_shard() % numShards].failedTries.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        acquired(wasHeld, 0, requested);
+        return true;
+    }
+
+    void unlock() {
+        profiled_unlock([this]() { inner.unlock(); });
+    }
+
+    template <typename NodeType>
+    void lock(NodeType& node) {
+        profiled_lock([this, &node]() { inner.lock(node); });
+    }
+
+    template <typename NodeType>
+    void unlock(NodeType& node) {
+        profiled_unlock([this, &node]() { inner.unlock(node); });
+    }
+
+    void acquire() { lock(); }
+    void release() { unlock(); }
+
+    // Sum of the shards: exact once the lock is quiescent.
+    LockProfile snapshot() const {
+        LockProfile p;
+        for (unsigned i = 0; i < numShards; i++) {
+            p.acquisitions += shards[i].acquisitions.load(std::memory_order_relaxed);
+            p.contended += shards[i].contended.load(std::memory_order_relaxed);
+            p.failedTries += shards[i].failedTries.load(std::memory_order_relaxed);
+            p.spins += shards[i].spins.load(std::memory_order_relaxed);
+            p.waitTicks += shards[i].waitTicks.load(std::memory_order_relaxed);
+            p.holdTicks += shards[i].holdTicks.load(std::memory_order_relaxed);
+        }
+        return p;
+    }
+
+    void dump(std::ostream& out) const { print_lock_profile(out, name, snapshot()); }
+};
+
+static_assert(BasicLockable<ProfiledLock<TTASLock>>);
+static_assert(BasicLockable<ProfiledLock<MCSLock, false>>);
+static_assert(TimedLockable<ProfiledLock<TTASLock>>);
+static_assert(TimedLockable<ProfiledLock<MCSLock, false>>);
+
+#endif
@@ -0,0 +1,284 @@
+#ifndef SYNC_QUEUE_H
+#define SYNC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "config.h"
+#include "policy.h"
+#include "lock.h"
+
+// Job queues: a lock-free bounded MPMC ring and a Chase-Lev work-stealing
+// deque, plus the same interfaces over a std::deque guarded by any lock in
+// lock.h, so each lock-free structure can be measured against the locked
+// one it replaces.
+
+// Bounded multi-producer multi-consumer ring (Vyukov). Every cell carries
+// a sequence number that says whose turn it is: sequence == position means
+// free for the producer claiming that position, position + 1 means full
+// for the consumer claiming it. Producers and consumers only contend on
+// their own end's counter, and each end's counter has its own cache line.
+// SlotPadding = CacheLinePadding also gives every cell its own line, so
+// neighbouring cells filled by different threads do not false-share.
+template <typename T, typename SlotPadding = NoPadding>
+class BoundedMPMCQueue {
+private:
+    struct alignas(SlotPadding::alignment) Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head{0};   // next position to push
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0};   // next position to pop
+
+    static size_t round_up(size_t n) {
+        size_t power = 2;
+        while (power < n) {
+            power *= 2;
+        }
+        return power;
+    }
+
+public:
+    // Capacity is rounded up to a power of two.
+    explicit BoundedMPMCQueue(size_t capacity = 4096)
+        : mask(round_up(capacity) - 1), cells(new Cell[mask + 1]) {
+        for (size_t i = 0; i <= mask; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    // False if the queue is full.
+    bool try_push(const T& value) {
+        size_t position = head.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.data = value;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false; // the consumer a lap behind has not emptied it
+            } else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // False if the queue is empty.
+    bool try_pop(T& value) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (difference == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = cell.data;
+                    cell.sequence.store(position + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false; // its producer has not filled it yet
+            } else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+// The same bounded queue as a std::deque under LockType.
+template <typename T, typename LockType>
+class LockedQueue {
+private:
+    LockType lock;
+    const size_t limit;
+    std::deque<T> items;
+
+public:
+    explicit LockedQueue(size_t capacity = 4096) : limit(capacity) {}
+
+    size_t capacity() const { return limit; }
+
+    bool try_push(const T& value) {
+        std::lock_guard<LockType> guard(lock);
+        if (items.size() >= limit) {
+            return false;
+        }
+        items.push_back(value);
+        return true;
+    }
+
+    bool try_pop(T& value) {
+        std::lock_guard<LockType> guard(lock);
+        if (items.empty()) {
+            return false;
+        }
+        value = items.front();
+        items.pop_front();
+        return true;
+    }
+};
+
+// Chase-Lev work-stealing deque, with the memory orders of Lê et al., "Correct
+// and Efficient Work-Stealing for Weak Memory Models". The owning thread
+// pushes and pops at the bottom without any RMW except when racing for the
+// last element; other threads steal from the top with one CAS. The ring
+// grows when full. Thieves may still be reading a replaced ring, so old
+// rings are kept until the deque is destroyed.
+template <typename T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "elements are copied through std::atomic<T>");
+
+private:
+    struct Ring {
+        const int64_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+
+        explicit Ring(int64_t capacity) : mask(capacity - 1), slots(new std::atomic<T>[capacity]) {}
+
+        int64_t capacity() const { return mask + 1; }
+        T get(int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, const T& value) { slots[i & mask].store(value, std::memory_order_relaxed); }
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> top{0};      // thieves
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> bottom{0};   // owner
+    std::atomic<Ring*> ring;
+    std::vector<std::unique_ptr<Ring>> rings;                  // owner only
+
+    Ring* grow(Ring* old, int64_t top, int64_t bottom) {
+        rings.push_back(std::make_unique<Ring>(old->capacity() * 2));
+        Ring* bigger = rings.back().get();
+        for (int64_t i = top; i < bottom; i++) {
+            bigger->put(i, old->get(i));
+        }
+        ring.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+public:
+    // Capacity must be a power of two.
+    explicit WorkStealingDeque(int64_t capacity = 1024) {
+        rings.push_back(std::make_unique<Ring>(capacity));
+        ring.store(rings.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Owner only.
+    void push(const T& value) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Ring* r = ring.load(std::memory_order_relaxed);
+        if (b - t > r->capacity() - 1) {
+            r = grow(r, t, b);
+        }
+        r->put(b, value);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only: the most recently pushed element, false if empty.
+    bool pop(T& value) {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring* r = ring.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        value = r->get(b);
+        if (t == b) {
+            // last element: race the thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread. Exact only while the owner is not pushing.
+    bool empty() const {
+        return top.load(std::memory_order_acquire) >= bottom.load(std::memory_order_acquire);
+    }
+
+    // Any thread: the oldest element, false if empty or lost to another
+    // thief or the owner.
+    bool steal(T& value) {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+        T stolen = ring.load(std::memory_order_acquire)->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return false;
+        }
+        value = stolen;
+        return true;
+    }
+};
+
+// The same deque as a std::deque under LockType: the owner works at the
+// back, thieves take from the front.
+template <typename T, typename LockType>
+class LockedDeque {
+private:
+    LockType lock;
+    std::deque<T> items;
+
+public:
+    explicit LockedDeque(int64_t = 1024) {}
+
+    bool empty() {
+        std::lock_guard<LockType> guard(lock);
+        return items.empty();
+    }
+
+    void push(const T& value) {
+        std::lock_guard<LockType> guard(lock);
+        items.push_back(value);
+    }
+
+    bool pop(T& value) {
+        std::lock_guard<LockType> guard(lock);
+        if (items.empty()) {
+            return false;
+        }
+        value = items.back();
+        items.pop_back();
+        return true;
+    }
+
+    bool steal(T& value) {
+        std::lock_guard<LockType> guard(lock);
+        if (items.empty()) {
+            return false;
+        }
+        value = items.front();
+        items.pop_front();
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,401 @@
+#ifndef SYNC_RECLAIM_H
+#define SYNC_RECLAIM_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "config.h"
+
+// Safe memory reclamation for lock-free linked structures: a node unlinked
+// by one thread may still be read by another that loaded a pointer to it
+// just before, so it is retire()d instead of deleted and freed once no
+// thread can hold a reference.
+//
+// Both domains have the same shape. A Guard marks one operation; its
+// protect() loads a shared pointer so that the node stays valid until the
+// guard ends:
+//
+//     typename Domain::Guard guard(domain);
+//     Node* head = guard.protect(top);
+//     ...                                    // head may be dereferenced
+//     if (top.compare_exchange_strong(head, head->next)) {
+//         domain.retire(head);
+//     }
+//
+// EpochDomain costs a fence per outermost guard but lets one stalled
+// thread hold back every free; BasicHazardDomain costs a fence per
+// protect() but bounds how many retired nodes can be waiting.
+
+// A retired node and how to free it.
+struct RetiredNode {
+    void* object;
+    void (*destroy)(void*);
+
+    template <typename T>
+    static RetiredNode of(T* object) {
+        return {object, [](void* p) { delete static_cast<T*>(p); }};
+    }
+
+    void free() const { destroy(object); }
+};
+
+// retired - freed is what is still waiting. peakPending adds up every
+// thread's own peak, so it bounds the true peak from above.
+struct ReclaimStats {
+    uint64_t retired = 0;
+    uint64_t freed = 0;
+    uint64_t peakPending = 0;
+
+    uint64_t pending() const { return retired - freed; }
+};
+
+// The per-thread records of one domain, in a lock-free list. A thread gets
+// its record the first time it uses the domain and keeps it for the
+// domain's lifetime; domains are told apart by a serial number, as in
+// BarrierThreadIds, so a new domain at a recycled address does not hand out
+// stale records. Records are freed with the domain.
+template <typename Record>
+class ThreadRecords {
+private:
+    const uint64_t serial;
+    std::atomic<Record*> head{nullptr};
+    std::atomic<unsigned> count{0};
+
+    static uint64_t next_serial() {
+        static std::atomic<uint64_t> serials{0};
+        return serials.fetch_add(1, std::memory_order_relaxed);
+    }
+
+public:
+    ThreadRecords() : serial(next_serial()) {}
+
+    ThreadRecords(const ThreadRecords&) = delete;
+    ThreadRecords& operator=(const ThreadRecords&) = delete;
+
+    ~ThreadRecords() {
+        Record* r = head.load(std::memory_order_relaxed);
+        while (r != nullptr) {
+            Record* next = r->next;
+            delete r;
+            r = next;
+        }
+    }
+
+    Record& mine() {
+        thread_local std::vector<std::pair<uint64_t, Record*>> records;
+        if (!records.empty() && records.back().first == serial) {
+            return *records.back().second;
+        }
+        for (auto& entry : records) {
+            if (entry.first == serial) {
+                return *entry.second;
+            }
+        }
+
+        Record* record = new Record;
+        record->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(record->next, record, std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+        }
+        count.fetch_add(1, std::memory_order_relaxed);
+        records.emplace_back(serial, record);
+        return *record;
+    }
+
+    template <typename F>
+    void for_each(F&& f) {
+        for (Record* r = head.load(std::memory_order_acquire); r != nullptr; r = r->next) {
+            f(*r);
+        }
+    }
+
+    unsigned size() const { return count.load(std::memory_order_relaxed); }
+};
+
+// Bookkeeping every record carries for ReclaimStats. Written by the owner
+// only; atomic so stats() can read it while the owner runs.
+struct ReclaimCounts {
+    std::atomic<uint64_t> retired{0};
+    std::atomic<uint64_t> freed{0};
+    std::atomic<uint64_t> peak{0};
+
+    void on_retire() {
+        uint64_t r = retired.load(std::memory_order_relaxed) + 1;
+        retired.store(r, std::memory_order_relaxed);
+        uint64_t pending = r - freed.load(std::memory_order_relaxed);
+        if (pending > peak.load(std::memory_order_relaxed)) {
+            peak.store(pending, std::memory_order_relaxed);
+        }
+    }
+
+    void on_free(uint64_t n) { freed.store(freed.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+    void add_to(ReclaimStats& s) const {
+        s.retired += retired.load(std::memory_order_relaxed);
+        s.freed += freed.load(std::memory_order_relaxed);
+        s.peakPending += peak.load(std::memory_order_relaxed);
+    }
+};
+
+// Epoch-based reclamation (Fraser). A global epoch advances once every
+// thread inside a guard has announced the current one. A node retired in
+// epoch e is unreachable to any guard that starts after it, and every guard
+// that started earlier has ended by the time the epoch reaches e + 2, so
+// it can then be freed. Each thread keeps three limbo bags, one per epoch
+// mod 3, and only tries to advance and free every Batch retires, so the
+// retire path is a vector push. Guards nest.
+//
+// A thread that stalls inside a guard stops the epoch and with it every
+// free: memory is unbounded in the worst case.
+template <unsigned Batch = 64>
+class BasicEpochDomain {
+private:
+    static constexpr uint64_t QUIESCENT = std::numeric_limits<uint64_t>::max();
+
+    struct LimboBag {
+        uint64_t epoch = 0;
+        std::vector<RetiredNode> nodes;
+    };
+
+    struct alignas(CACHE_LINE_SIZE) Record {
+        std::atomic<uint64_t> announced{QUIESCENT}; // epoch entered, or QUIESCENT
+        unsigned nesting = 0;
+        unsigned sinceCollect = 0;
+        LimboBag bags[3];
+        ReclaimCounts counts;
+        Record* next = nullptr;
+
+        ~Record() {
+            for (LimboBag& bag : bags) {
+                for (const RetiredNode& node : bag.nodes) {
+                    node.free();
+                }
+            }
+        }
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> epoch{0};
+    ThreadRecords<Record> records;
+
+    void free_bag(Record& r, LimboBag& bag) {
+        for (const RetiredNode& node : bag.nodes) {
+            node.free();
+        }
+        r.counts.on_free(bag.nodes.size());
+        bag.nodes.clear();
+    }
+
+    void try_advance(uint64_t e) {
+        bool everyoneCaughtUp = true;
+        records.for_each([&](Record& r) {
+            uint64_t a = r.announced.load();
+            everyoneCaughtUp = everyoneCaughtUp && (a == QUIESCENT || a == e);
+        });
+        if (everyoneCaughtUp) {
+            epoch.compare_exchange_strong(e, e + 1);
+        }
+    }
+
+    void collect(Record& r) {
+        uint64_t e = epoch.load();
+        for (LimboBag& bag : r.bags) {
+            if (!bag.nodes.empty() && bag.epoch + 2 <= e) {
+                free_bag(r, bag);
+            }
+        }
+    }
+
+public:
+    class Guard {
+    private:
+        Record& record;
+
+    public:
+        explicit Guard(BasicEpochDomain& domain) : record(domain.records.mine()) {
+            if (record.nesting++ == 0) {
+                // the fence orders the announcement before the acquire
+                // loads in protect(); with the one in retire() a reclaimer
+                // that unlinked a node either sees this announcement or
+                // this guard misses the node
+                record.announced.store(domain.epoch.load());
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        ~Guard() {
+            if (--record.nesting == 0) {
+                record.announced.store(QUIESCENT, std::memory_order_release);
+            }
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        template <typename T>
+        T* protect(const std::atomic<T*>& source) {
+            return source.load(std::memory_order_acquire);
+        }
+    };
+
+    BasicEpochDomain() = default;
+    BasicEpochDomain(const BasicEpochDomain&) = delete;
+    BasicEpochDomain& operator=(const BasicEpochDomain&) = delete;
+
+    // Frees everything still in limbo: no thread may be using the domain.
+    ~BasicEpochDomain() = default;
+
+    // object must already be unreachable from the shared structure.
+    template <typename T>
+    void retire(T* object) {
+        // pairs with the fence in Guard: the unlink is ordered before the
+        // epoch read and the announcements scanned below
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        Record& r = records.mine();
+        uint64_t e = epoch.load();
+        LimboBag& bag = r.bags[e % 3];
+        if (bag.epoch != e) {
+            // same slot, three or more epochs old
+            free_bag(r, bag);
+            bag.epoch = e;
+        }
+        bag.nodes.push_back(RetiredNode::of(object));
+        r.counts.on_retire();
+
+        if (++r.sinceCollect >= Batch) {
+            r.sinceCollect = 0;
+            try_advance(e);
+            collect(r);
+        }
+    }
+
+    ReclaimStats stats() {
+        ReclaimStats s;
+        records.for_each([&](Record& r) { r.counts.add_to(s); });
+        return s;
+    }
+};
+
+// Hazard pointers (Michael). Each thread publishes up to HazardsPerThread
+// pointers it is about to dereference; a retired node is freed only when
+// no published pointer names it. A thread scans everyone's hazards once
+// its retired list reaches twice the number of hazards in the domain (at
+// least Batch), so at most that many nodes per thread are ever waiting,
+// however slow the other threads are. Nested guards take the next hazard
+// slot.
+template <unsigned HazardsPerThread = 2, unsigned Batch = 64>
+class BasicHazardDomain {
+private:
+    struct alignas(CACHE_LINE_SIZE) Record {
+        std::atomic<void*> hazards[HazardsPerThread] = {};
+        unsigned used = 0;
+        std::vector<RetiredNode> retired;
+        ReclaimCounts counts;
+        Record* next = nullptr;
+
+        ~Record() {
+            for (const RetiredNode& node : retired) {
+                node.free();
+            }
+        }
+    };
+
+    ThreadRecords<Record> records;
+
+    void scan(Record& r) {
+        // pairs with the seq_cst hazard store in protect(): the unlinks of
+        // the nodes retired so far are ordered before the hazard reads
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::vector<void*> hazards;
+        records.for_each([&](Record& other) {
+            for (auto& h : other.hazards) {
+                if (void* p = h.load()) {
+                    hazards.push_back(p);
+                }
+            }
+        });
+        std::sort(hazards.begin(), hazards.end());
+
+        auto keep = std::partition(r.retired.begin(), r.retired.end(), [&](const RetiredNode& node) {
+            return std::binary_search(hazards.begin(), hazards.end(), node.object);
+        });
+        for (auto it = keep; it != r.retired.end(); ++it) {
+            it->free();
+        }
+        r.counts.on_free(r.retired.end() - keep);
+        r.retired.erase(keep, r.retired.end());
+    }
+
+public:
+    class Guard {
+    private:
+        std::atomic<void*>& hazard;
+        Record& record;
+
+        static std::atomic<void*>& claim(Record& record) {
+            assert(record.used < HazardsPerThread && "guards nested deeper than HazardsPerThread");
+            return record.hazards[record.used++];
+        }
+
+        explicit Guard(Record& record) : hazard(claim(record)), record(record) {}
+
+    public:
+        explicit Guard(BasicHazardDomain& domain) : Guard(domain.records.mine()) {}
+
+        ~Guard() {
+            hazard.store(nullptr, std::memory_order_release);
+            record.used--;
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        // Publishes the pointer, then re-reads the source: if it still
+        // holds the same pointer, the node was reachable after the hazard
+        // became visible, so no scan that started later can free it.
+        template <typename T>
+        T* protect(const std::atomic<T*>& source) {
+            T* p = source.load(std::memory_order_relaxed);
+            while (true) {
+                hazard.store(p); // seq_cst: visible before the re-read
+                T* again = source.load();
+                if (again == p) {
+                    return p;
+                }
+                p = again;
+            }
+        }
+    };
+
+    BasicHazardDomain() = default;
+    BasicHazardDomain(const BasicHazardDomain&) = delete;
+    BasicHazardDomain& operator=(const BasicHazardDomain&) = delete;
+
+    // Frees every retired node: no thread may be using the domain.
+    ~BasicHazardDomain() = default;
+
+    // object must already be unreachable from the shared structure.
+    template <typename T>
+    void retire(T* object) {
+        Record& r = records.mine();
+        r.retired.push_back(RetiredNode::of(object));
+        r.counts.on_retire();
+        if (r.retired.size() >= std::max<size_t>(Batch, 2 * HazardsPerThread * records.size())) {
+            scan(r);
+        }
+    }
+
+    ReclaimStats stats() {
+        ReclaimStats s;
+        records.for_each([&](Record& r) { r.counts.add_to(s); });
+        return s;
+    }
+};
+
+using EpochDomain = BasicEpochDomain<>;
+using HazardDomain = BasicHazardDomain<>;
+
+#endif
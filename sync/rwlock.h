@@ -0,0 +1,246 @@
+#ifndef SYNC_RWLOCK_H
+#define SYNC_RWLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+#include <concepts>
+#include "config.h"
+#include "lock.h"
+
+// Reader-writer locks satisfy SharedLockable on top of BasicLockable, so
+// they work with std::shared_lock as well as std::lock_guard. Both sides
+// can also be tried and timed, as with std::shared_timed_mutex.
+template <typename L>
+concept SharedLockable = BasicLockable<L> && requires(L& l) {
+    l.lock_shared();
+    l.unlock_shared();
+};
+
+template <typename L>
+concept SharedTimedLockable = SharedLockable<L> && TimedLockable<L> && requires(L& l) {
+    { l.try_lock_shared() } -> std::convertible_to<bool>;
+    { l.try_lock_shared_for(std::chrono::microseconds(1)) } -> std::convertible_to<bool>;
+    { l.try_lock_shared_until(std::chrono::steady_clock::now()) } -> std::convertible_to<bool>;
+};
+
+// The shared side of TimedTryLock: try_lock_shared() polled until the
+// deadline.
+template <typename Derived>
+class TimedTryLockShared : public TimedTryLock<Derived> {
+public:
+    template <typename Clock, typename Duration>
+    bool try_lock_shared_until(const std::chrono::time_point<Clock, Duration>& deadline) {
+        return poll_until(deadline, [this]() { return static_cast<Derived*>(this)->try_lock_shared(); });
+    }
+
+    template <typename Rep, typename Period>
+    bool try_lock_shared_for(const std::chrono::duration<Rep, Period>& timeout) {
+        return try_lock_shared_until(std::chrono::steady_clock::now() + timeout);
+    }
+};
+
+// Phase-fair ticket reader-writer lock (Brandenburg & Anderson, PF-T).
+// Reader and writer phases alternate: a writer waits for at most one
+// reader phase, and a reader for at most one writer phase. Readers
+// register by bumping rin by READER_INC; the low bits of rin say whether a
+// writer is present and which phase it belongs to. Writers queue among
+// themselves the way TicketLock does. The phase comes from writerPhase,
+// which only writers that actually raised the bits advance, so
+// consecutive writer phases always differ even when try_lock() gives a
+// ticket back.
+template <typename Padding = NoPadding>
+class BasicPhaseFairRWLock : public TimedTryLockShared<BasicPhaseFairRWLock<Padding>> {
+private:
+    static constexpr uint32_t READER_INC = 0x100;
+    static constexpr uint32_t WRITER_BITS = 0x3;
+    static constexpr uint32_t WRITER_PRESENT = 0x2;
+    static constexpr uint32_t PHASE_ID = 0x1;
+
+    alignas(Padding::alignment) alignas(std::atomic<uint32_t>) std::atomic<uint32_t> rin{0};
+    alignas(Padding::alignment) alignas(std::atomic<uint32_t>) std::atomic<uint32_t> rout{0};
+    alignas(Padding::alignment) alignas(std::atomic<uint32_t>) std::atomic<uint32_t> win{0};
+    alignas(Padding::alignment) alignas(std::atomic<uint32_t>) std::atomic<uint32_t> wout{0};
+    uint32_t writerPhase = 0; // only the ticket holder touches it
+
+public:
+    void lock_shared() {
+        uint32_t writer = rin.fetch_add(READER_INC, std::memory_order_acquire) & WRITER_BITS;
+        // wait only for the writer phase that was present when we arrived
+        while (writer != 0 && writer == (rin.load(std::memory_order_acquire) & WRITER_BITS)) {
+            cpu_relax();
+        }
+    }
+
+    // Registers with a CAS instead of fetch_add, and only while no writer
+    // is present: a registration cannot be undone, since a writer that
+    // sampled rin would then wait for an exit that never comes.
+    bool try_lock_shared() {
+        uint32_t value = rin.load(std::memory_order_relaxed);
+        while ((value & WRITER_BITS) == 0) {
+            if (rin.compare_exchange_weak(value, value + READER_INC, std::memory_order_acquire,
+                                          std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void unlock_shared() {
+        rout.fetch_add(READER_INC, std::memory_order_release);
+    }
+
+    // Takes the writer ticket only if it is served at once, as in
+    // TicketLock, and raises the writer bits only if no reader is inside
+    // (rin == rout); otherwise hands the ticket straight on. A ticket handed
+    // on leaves writerPhase alone: the next writer must still raise the
+    // other phase, or a reader waiting out the previous writer could not
+    // tell the two apart and would wait forever.
+    bool try_lock() {
+        uint32_t readers = rout.load(std::memory_order_acquire);
+        if (rin.load(std::memory_order_relaxed) != readers) {
+            return false;
+        }
+        uint32_t ticket = wout.load(std::memory_order_acquire);
+        uint32_t expected = ticket;
+        if (!win.compare_exchange_strong(expected, ticket + 1, std::memory_order_relaxed)) {
+            return false;
+        }
+
+        readers = rout.load(std::memory_order_acquire);
+        if (rin.compare_exchange_strong(readers, readers | WRITER_PRESENT | (writerPhase & PHASE_ID),
+                                        std::memory_order_acquire, std::memory_order_relaxed)) {
+            return true;
+        }
+        wout.store(ticket + 1, std::memory_order_release);
+        return false;
+    }
+
+    void lock() {
+        uint32_t ticket = win.fetch_add(1, std::memory_order_relaxed);
+        while (wout.load(std::memory_order_acquire) != ticket) {
+            cpu_relax();
+        }
+
+        // block new readers, then wait for the ones already inside
+        uint32_t writer = WRITER_PRESENT | (writerPhase & PHASE_ID);
+        uint32_t readers = rin.fetch_add(writer, std::memory_order_acquire);
+        while (rout.load(std::memory_order_acquire) != readers) {
+            cpu_relax();
+        }
+    }
+
+    void unlock() {
+        rin.fetch_and(~WRITER_BITS, std::memory_order_release);
+        // only the holder writes writerPhase and wout
+        writerPhase++;
+        wout.store(wout.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+using PhaseFairRWLock = BasicPhaseFairRWLock<>;
+
+// Big-reader lock: every reader slot has its own cache line, so readers on
+// different slots never write a shared line. Threads get a slot
+// round-robin the first time they read, so with one slot per hardware
+// thread the slots behave like per-core reader indicators. Writers
+// serialize on WriterLock, raise the writer flag and wait for every slot
+// to drain, which makes writes O(slots) and suits read-mostly data.
+template <typename WriterLock = TicketLock>
+class BigReaderLock : public TimedTryLockShared<BigReaderLock<WriterLock>> {
+private:
+    struct alignas(CACHE_LINE_SIZE) ReaderSlot {
+        std::atomic<uint32_t> readers{0};
+    };
+
+    std::unique_ptr<ReaderSlot[]> slots;
+    const unsigned numSlots;
+    WriterLock writerLock;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> writer{false};
+
+    static unsigned thread_slot() {
+        static std::atomic<unsigned> nextSlot{0};
+        thread_local unsigned slot = nextSlot.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+
+    ReaderSlot& my_slot() { return slots[thread_slot() % numSlots]; }
+
+public:
+    explicit BigReaderLock(unsigned numSlots = std::max(1u, std::thread::hardware_concurrency()))
+        : slots(new ReaderSlot[numSlots]), numSlots(numSlots) {}
+
+    void lock_shared() {
+        ReaderSlot& slot = my_slot();
+        while (true) {
+            // seq_cst on both sides: the reader's increment and the
+            // writer's flag must not both be missed (Dekker-style)
+            slot.readers.fetch_add(1, std::memory_order_seq_cst);
+            if (!writer.load(std::memory_order_seq_cst)) {
+                return;
+            }
+
+            // back out so the writer can drain, then wait for it
+            slot.readers.fetch_sub(1, std::memory_order_relaxed);
+            while (writer.load(std::memory_order_relaxed)) {
+                cpu_relax();
+            }
+        }
+    }
+
+    bool try_lock_shared() {
+        ReaderSlot& slot = my_slot();
+        slot.readers.fetch_add(1, std::memory_order_seq_cst);
+        if (!writer.load(std::memory_order_seq_cst)) {
+            return true;
+        }
+        slot.readers.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void unlock_shared() {
+        my_slot().readers.fetch_sub(1, std::memory_order_release);
+    }
+
+    // Raises the writer flag only long enough to see whether every slot is
+    // already empty; readers that backed off for it simply retry.
+    bool try_lock() {
+        if (!writerLock.try_lock()) {
+            return false;
+        }
+        writer.store(true, std::memory_order_seq_cst);
+        for (unsigned i = 0; i < numSlots; i++) {
+            if (slots[i].readers.load(std::memory_order_seq_cst) != 0) {
+                writer.store(false, std::memory_order_release);
+                writerLock.unlock();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void lock() {
+        writerLock.lock();
+        // the writer's half of the handshake in lock_shared(): flag store
+        // and slot loads are all seq_cst
+        writer.store(true, std::memory_order_seq_cst);
+        for (unsigned i = 0; i < numSlots; i++) {
+            while (slots[i].readers.load(std::memory_order_seq_cst) != 0) {
+                cpu_relax();
+            }
+        }
+    }
+
+    void unlock() {
+        writer.store(false, std::memory_order_release);
+        writerLock.unlock();
+    }
+};
+
+static_assert(SharedTimedLockable<PhaseFairRWLock>);
+static_assert(SharedTimedLockable<BigReaderLock<>>);
+
+#endif
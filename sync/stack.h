@@ -0,0 +1,125 @@
+#ifndef SYNC_STACK_H
+#define SYNC_STACK_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include "config.h"
+#include "reclaim.h"
+
+// LIFO stacks of heap nodes: a lock-free Treiber stack whose popped nodes
+// go through a reclamation domain (reclaim.h), and a linked stack under any
+// lock in lock.h that frees nodes directly, to measure the lock-free one
+// against in both throughput and memory held.
+
+// Treiber stack. push() is one CAS on the top; pop() protects the top so
+// the node cannot be freed, and its address reused, between reading its
+// next pointer and the CAS, which also rules out ABA.
+template <typename T, typename Domain = EpochDomain>
+class LockFreeStack {
+private:
+    struct Node {
+        T value;
+        Node* next;
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<Node*> top{nullptr};
+    alignas(CACHE_LINE_SIZE) Domain reclaimer;
+
+public:
+    static constexpr size_t node_bytes = sizeof(Node);
+
+    LockFreeStack() = default;
+    LockFreeStack(const LockFreeStack&) = delete;
+    LockFreeStack& operator=(const LockFreeStack&) = delete;
+
+    // No thread may be using the stack.
+    ~LockFreeStack() {
+        Node* node = top.load(std::memory_order_relaxed);
+        while (node != nullptr) {
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    void push(const T& value) {
+        Node* node = new Node{value, top.load(std::memory_order_relaxed)};
+        while (!top.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+    // False if the stack is empty.
+    bool pop(T& value) {
+        typename Domain::Guard guard(reclaimer);
+        while (true) {
+            Node* node = guard.protect(top);
+            if (node == nullptr) {
+                return false;
+            }
+            if (top.compare_exchange_weak(node, node->next, std::memory_order_acquire, std::memory_order_relaxed)) {
+                value = node->value;
+                reclaimer.retire(node);
+                return true;
+            }
+        }
+    }
+
+    // Nodes retired, freed and at most waiting at once.
+    ReclaimStats reclamation() { return reclaimer.stats(); }
+};
+
+// The same stack under LockType.
+template <typename T, typename LockType>
+class LockedStack {
+private:
+    struct Node {
+        T value;
+        Node* next;
+    };
+
+    LockType lock;
+    Node* top = nullptr;
+
+public:
+    static constexpr size_t node_bytes = sizeof(Node);
+
+    LockedStack() = default;
+    LockedStack(const LockedStack&) = delete;
+    LockedStack& operator=(const LockedStack&) = delete;
+
+    ~LockedStack() {
+        while (top != nullptr) {
+            Node* next = top->next;
+            delete top;
+            top = next;
+        }
+    }
+
+    void push(const T& value) {
+        Node* node = new Node{value, nullptr};
+        std::lock_guard<LockType> guard(lock);
+        node->next = top;
+        top = node;
+    }
+
+    bool pop(T& value) {
+        Node* node;
+        {
+            std::lock_guard<LockType> guard(lock);
+            if (top == nullptr) {
+                return false;
+            }
+            node = top;
+            top = node->next;
+        }
+        value = node->value;
+        delete node;
+        return true;
+    }
+
+    // Nodes are freed as they are popped: nothing ever waits.
+    ReclaimStats reclamation() { return {}; }
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef SYNC_SYNC_H
+#define SYNC_SYNC_H
+
+// Umbrella header for the synchronization library shared by the exercises.
+
+#include "config.h"
+#include "futex.h"
+#include "clock.h"
+#include "backoff.h"
+#include "policy.h"
+#include "park.h"
+#include "topology.h"
+#include "lock.h"
+#include "profile.h"
+#include "elision.h"
+#include "barrier.h"
+#include "rwlock.h"
+#include "combining.h"
+#include "delegation.h"
+#include "counter.h"
+#include "queue.h"
+#include "reclaim.h"
+#include "stack.h"
+#include "pool.h"
+#include "parallel.h"
+
+#endif
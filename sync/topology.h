@@ -0,0 +1,294 @@
+#ifndef SYNC_TOPOLOGY_H
+#define SYNC_TOPOLOGY_H
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <tuple>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+// Parses a sysfs cpulist such as "0-3,8-11".
+inline std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// First line of a sysfs file, or "" if it cannot be read.
+inline std::string read_sysfs_line(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+// NUMA layout of the machine, read once from sysfs. Machines without
+// /sys/devices/system/node (or non-Linux hosts) look like a single node
+// holding every CPU.
+class NumaTopology {
+private:
+    std::vector<std::vector<int>> nodeCpus;
+    std::vector<int> cpuNode;
+
+    NumaTopology() {
+        for (int node = 0;; node++) {
+            std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!in) {
+                break;
+            }
+            std::string list;
+            std::getline(in, list);
+            nodeCpus.push_back(parse_cpu_list(list));
+        }
+
+        if (nodeCpus.empty()) {
+            int cpus = std::max(1u, std::thread::hardware_concurrency());
+            nodeCpus.emplace_back();
+            for (int cpu = 0; cpu < cpus; cpu++) {
+                nodeCpus[0].push_back(cpu);
+            }
+        }
+
+        for (int node = 0; node < static_cast<int>(nodeCpus.size()); node++) {
+            for (int cpu : nodeCpus[node]) {
+                if (cpu >= static_cast<int>(cpuNode.size())) {
+                    cpuNode.resize(cpu + 1, 0);
+                }
+                cpuNode[cpu] = node;
+            }
+        }
+    }
+
+public:
+    static const NumaTopology& get() {
+        static const NumaTopology topology;
+        return topology;
+    }
+
+    int node_count() const { return static_cast<int>(nodeCpus.size()); }
+
+    const std::vector<int>& cpus_of_node(int node) const { return nodeCpus[node]; }
+
+    int node_of_cpu(int cpu) const {
+        return cpu >= 0 && cpu < static_cast<int>(cpuNode.size()) ? cpuNode[cpu] : 0;
+    }
+};
+
+// CPU the calling thread is running on right now, or 0 if unknown.
+inline int current_cpu() {
+#if defined(__linux__)
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : cpu;
+#else
+    return 0;
+#endif
+}
+
+inline int current_numa_node() {
+    return NumaTopology::get().node_of_cpu(current_cpu());
+}
+
+// Socket, core and SMT layout of the CPUs this process may run on, read
+// once from /sys/devices/system/cpu/cpuN/topology. Without sysfs every CPU
+// is its own core on socket 0.
+class CpuTopology {
+public:
+    struct Cpu {
+        int id;
+        int package;    // socket
+        int core;       // core_id, unique within the package only
+        int coreRank;   // index of the core within its package
+        int smt;        // index among the core's hardware threads
+    };
+
+private:
+    std::vector<Cpu> cpus;
+    int packages = 1;
+
+    static std::vector<int> allowed_cpus() {
+        std::vector<int> online = parse_cpu_list(read_sysfs_line("/sys/devices/system/cpu/online"));
+        if (online.empty()) {
+            for (int cpu = 0; cpu < static_cast<int>(std::max(1u, std::thread::hardware_concurrency())); cpu++) {
+                online.push_back(cpu);
+            }
+        }
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            std::vector<int> allowed;
+            for (int cpu : online) {
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &set)) {
+                    allowed.push_back(cpu);
+                }
+            }
+            if (!allowed.empty()) {
+                return allowed;
+            }
+        }
+#endif
+        return online;
+    }
+
+    static int read_topology_id(int cpu, const std::string& file, int fallback) {
+        std::string value = read_sysfs_line("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + file);
+        return value.empty() ? fallback : std::stoi(value);
+    }
+
+    CpuTopology() {
+        for (int cpu : allowed_cpus()) {
+            cpus.push_back({cpu, read_topology_id(cpu, "physical_package_id", 0),
+                            read_topology_id(cpu, "core_id", cpu), 0, 0});
+        }
+
+        // Rank cores within their package and threads within their core,
+        // both by ascending id.
+        std::vector<Cpu> sorted = cpus;
+        std::sort(sorted.begin(), sorted.end(), [](const Cpu& a, const Cpu& b) {
+            return std::tie(a.package, a.core, a.id) < std::tie(b.package, b.core, b.id);
+        });
+        for (size_t i = 0; i < sorted.size(); i++) {
+            if (i == 0 || sorted[i].package != sorted[i - 1].package) {
+                sorted[i].coreRank = 0;
+                sorted[i].smt = 0;
+            } else if (sorted[i].core != sorted[i - 1].core) {
+                sorted[i].coreRank = sorted[i - 1].coreRank + 1;
+                sorted[i].smt = 0;
+            } else {
+                sorted[i].coreRank = sorted[i - 1].coreRank;
+                sorted[i].smt = sorted[i - 1].smt + 1;
+            }
+        }
+        cpus = sorted;
+
+        packages = 0;
+        for (const Cpu& cpu : cpus) {
+            packages = std::max(packages, cpu.package + 1);
+        }
+    }
+
+public:
+    static const CpuTopology& get() {
+        static const CpuTopology topology;
+        return topology;
+    }
+
+    const std::vector<Cpu>& all() const { return cpus; }
+    int package_count() const { return packages; }
+};
+
+// Where benchmark threads go. Thread i runs on cpus[i % cpus.size()] of
+// the list placement_cpus() returns:
+//   none            no pinning; the scheduler decides
+//   compact         one thread per core of socket 0, then its SMT siblings,
+//                   then the next socket
+//   scatter         round-robin over sockets, one thread per core, SMT
+//                   siblings only once every core has a thread
+//   smt-first       both hardware threads of a core before the next core
+//   one-per-socket  the first core of each socket only; more threads than
+//                   sockets share those CPUs
+enum class Placement { None, Compact, Scatter, SmtFirst, OnePerSocket };
+
+inline const char* placement_name(Placement placement) {
+    switch (placement) {
+    case Placement::Compact: return "compact";
+    case Placement::Scatter: return "scatter";
+    case Placement::SmtFirst: return "smt-first";
+    case Placement::OnePerSocket: return "one-per-socket";
+    default: return "none";
+    }
+}
+
+// Returns false if name is not a placement.
+inline bool parse_placement(const std::string& name, Placement& placement) {
+    for (Placement p : {Placement::None, Placement::Compact, Placement::Scatter, Placement::SmtFirst,
+                        Placement::OnePerSocket}) {
+        if (name == placement_name(p)) {
+            placement = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+// CPUs for the first numThreads threads under placement, in thread order.
+// Empty for Placement::None.
+inline std::vector<int> placement_cpus(Placement placement, int numThreads) {
+    using Cpu = CpuTopology::Cpu;
+    std::vector<Cpu> order = CpuTopology::get().all();
+    auto by = [&order](auto key) {
+        std::stable_sort(order.begin(), order.end(), [&key](const Cpu& a, const Cpu& b) { return key(a) < key(b); });
+    };
+
+    switch (placement) {
+    case Placement::None:
+        return {};
+    case Placement::Compact:
+        by([](const Cpu& c) { return std::tie(c.package, c.smt, c.coreRank); });
+        break;
+    case Placement::Scatter:
+        by([](const Cpu& c) { return std::tie(c.smt, c.coreRank, c.package); });
+        break;
+    case Placement::SmtFirst:
+        by([](const Cpu& c) { return std::tie(c.package, c.coreRank, c.smt); });
+        break;
+    case Placement::OnePerSocket:
+        by([](const Cpu& c) { return std::tie(c.smt, c.coreRank, c.package); });
+        order.resize(std::min<size_t>(order.size(), CpuTopology::get().package_count()));
+        break;
+    }
+
+    std::vector<int> cpus;
+    for (int i = 0; i < numThreads && !order.empty(); i++) {
+        cpus.push_back(order[i % order.size()].id);
+    }
+    return cpus;
+}
+
+// "0,2,4" for the output; "unpinned" for an empty list.
+inline std::string describe_cpus(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return "unpinned";
+    }
+    std::string text;
+    for (size_t i = 0; i < cpus.size(); i++) {
+        if (i) {
+            text += ',';
+        }
+        text += std::to_string(cpus[i]);
+    }
+    return text;
+}
+
+// Pins the calling thread to one CPU. Returns false if that is not possible.
+inline bool pin_current_thread(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+#endif